@@ -0,0 +1,25 @@
+#!/bin/sh
+# Checks that an overlay fits between OVL_ADDR and the heap, with the areas
+# of its .noi file: its code, and its data and statics after the code
+# (see include/overlay.h).
+# Usage: ovlcheck.sh out/z80bmsx2_cmd.noi
+
+awk 'function hex(str,   i, n) {
+	n = 0
+	str = tolower(str)
+	sub(/^0x/, "", str)
+	for (i=1; i<=length(str); i++) n = n*16 + index("0123456789abcdef", substr(str, i, 1)) - 1
+	return n
+}
+$1 == "DEF" && $2 ~ /^s__/ { start[substr($2, 4)] = hex($3) }
+$1 == "DEF" && $2 ~ /^l__/ { size[substr($2, 4)] = hex($3) }
+END {
+	last = 0
+	for (area in start) {
+		if (start[area] >= 32768 && size[area] && start[area] + size[area] > last) last = start[area] + size[area]
+	}
+	if (last > 40960) {
+		printf "%s: overlay ends at 0x%04X, over the heap at 0xA000\n", FILENAME, last > "/dev/stderr"
+		exit 1
+	}
+}' "$1"
@@ -0,0 +1,14 @@
+#!/bin/sh
+# Generates the absolute symbols of a resident binary from its .noi file, so
+# the overlays can be linked against it (see include/overlay.h).
+# Usage: ovlsyms.sh out/z80bmsx2.noi > out/z80bmsx2.sym.s
+
+awk '$1 == "DEF" && $2 ~ /^_/ && $2 != "_main" {
+	sub(/^0x/, "", $3)
+	printf "\t%s == 0x%s\n", $2, $3
+}
+BEGIN {
+	print "\t;--- Generated by bin/ovlsyms.sh: do not edit"
+	print ""
+	print "\t.area\t_CODE"
+}' "$1"
@@ -0,0 +1,259 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+
+	Host tool: renders the static part of the panels into RLE packed name
+	and blink tables, so the MSX only needs one VRAM copy to draw them.
+
+	Usage: panelimage 80|40 > out/panelXX.h
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "panelstr.h"
+
+
+// conio frameChars[] & lines with the MSX font
+#define FRAME_UP_LEFT		'\x18'
+#define FRAME_UP_RIGHT		'\x19'
+#define FRAME_DOWN_LEFT		'\x1a'
+#define FRAME_DOWN_RIGHT	'\x1b'
+#define FRAME_HORIZONTAL	'\x17'
+#define FRAME_VERTICAL		'\x16'
+
+#define ROWS	24
+
+static const char titleStr[] = PANEL_TITLE_STR;
+static const char authorStr[] = PANEL_AUTHOR_STR;
+static const char infoMachineStr[] = PANEL_MACHINE_STR;
+static const char infoCpuTypeStr[] = PANEL_CPUTYPE_STR;
+static const char infoVdpTypeStr[] = PANEL_VDPTYPE_STR;
+static const char info1Str[] = PANEL_INFO1_STR;
+static const char info2Str[] = PANEL_INFO2_STR;
+
+static uint8_t cols;
+static uint8_t names[ROWS*80];
+static uint8_t blink[ROWS*80/8];
+
+
+// ========================================================
+static void putlinexy(int x, int y, int len, const char *str)
+{
+	memcpy(&names[(y-1)*cols + x-1], str, len);
+}
+
+static void putstrxy(int x, int y, const char *str)
+{
+	putlinexy(x, y, strlen(str), str);
+}
+
+static void fillxy(int x, int y, int len, char c)
+{
+	memset(&names[(y-1)*cols + x-1], c, len);
+}
+
+static void cvlinexy(int x, int y, int len)
+{
+	while (len--) fillxy(x, y++, 1, FRAME_VERTICAL);
+}
+
+static void drawFrame(int left, int top, int right, int bottom)
+{
+	fillxy(left, top, 1, FRAME_UP_LEFT);
+	fillxy(left+1, top, right-left-1, FRAME_HORIZONTAL);
+	fillxy(right, top, 1, FRAME_UP_RIGHT);
+	cvlinexy(left, top+1, bottom-top-1);
+	cvlinexy(right, top+1, bottom-top-1);
+	fillxy(left, bottom, 1, FRAME_DOWN_LEFT);
+	fillxy(left+1, bottom, right-left-1, FRAME_HORIZONTAL);
+	fillxy(right, bottom, 1, FRAME_DOWN_RIGHT);
+}
+
+static void textblink(int x, int y, int len)
+{
+	int pos = (y-1)*80 + x-1;
+	while (len--) {
+		blink[pos/8] |= 0x80 >> (pos & 7);
+		pos++;
+	}
+}
+
+
+// ========================================================
+// Static part of drawPanel()
+static void panel80()
+{
+	static const char *axisYLabelsStr[] = {
+		"", "CPU speed", "(MHz)", "", "MSX standard", "(3.579MHz)", "", "MSX2+ tPANA", "(5.369MHz)"
+	};
+	static const char *speedLineStr = PANEL_SPEEDLINE80_STR;
+	const int GR_X = 17, GR_Y = 8, GR_H = 9, LABELSY_X = GR_X-13;
+	int i;
+
+	// Big frame
+	fillxy(1, 1, 80, '\x80');
+	fillxy(1, 24, 80, '\x80');
+	for (i=1; i<24; i++) {
+		fillxy(80, i, 2, '\x81');
+	}
+	fillxy(1, 1, 1, '\x82');
+	fillxy(80, 1, 1, '\x83');
+	fillxy(1, 24, 1, '\x84');
+	fillxy(80, 24, 1, '\x85');
+
+	// Title & author
+	putstrxy(5, 1, titleStr);
+	textblink(6, 1, strlen(titleStr)-2);
+	putstrxy(66, 1, authorStr);
+
+	// Info
+	drawFrame(3,2, 39,7);
+	putstrxy(5,3, infoMachineStr);
+	putstrxy(5,4, infoCpuTypeStr);
+	putstrxy(5,5, "CPU Speed : --");
+	putstrxy(5,6, infoVdpTypeStr);
+	for (i=3; i<7; i++) {
+		textblink(16,i, 23);
+	}
+
+	// Info frame
+	drawFrame(40, 2, 78, 7);
+	putstrxy(42, 3, "This computer performs ---% of an");
+	putstrxy(42, 5, info1Str);
+	putstrxy(42, 6, info2Str);
+	textblink(65,3, 5);
+
+	// Graph & axis X
+	cvlinexy(GR_X,GR_Y, GR_H);
+	fillxy(GR_X,GR_Y+GR_H, 1, FRAME_DOWN_LEFT);
+	for (i=1; i<7; i++) {
+		putlinexy(GR_X+i*10-9,GR_Y+GR_H, 10, "\x91\x90\x91\x90\x91\x90\x91\x90\x91\x8f");
+	}
+
+	// Y labels
+	for (i=0; i<9; i++) {
+		putlinexy(GR_X+1, GR_Y+i, 60, speedLineStr);
+		putstrxy(LABELSY_X, GR_Y+i, axisYLabelsStr[i]);
+	}
+	textblink(GR_X+1, GR_Y+1, 60);
+
+	// Key labels
+	fillxy(2, 21, 78, FRAME_HORIZONTAL);
+	putstrxy(55,22, "[F5] Cycle");
+	putstrxy(55,23, "Test kernel");
+	putstrxy(68,22, "[F6] Toggle");
+	putstrxy(68,23, "NTSC/PAL");
+	putstrxy(3, 20, "Keys restart the test");
+	putstrxy(65, 20, "[ESC] to exit");
+}
+
+// Static part of msx1_drawPanel()
+static void panel40()
+{
+	static const char *axisXLabelsStr[] = {
+		"  5", " 10", " 15", " 20", " 25", "30"
+	};
+	static const char *axisYLabelsStr[] = {
+		"", "CPU speed", "", "", "MSX std", "", "", "turboPANA", ""
+	};
+	static const char *speedLineStr = PANEL_SPEEDLINE40_STR;
+	const int GR_X = 10, GR_Y = 8, GR_H = 9, LABELSY_X = 1;
+	int i;
+
+	// Big frame
+	fillxy(1, 1, 40, '\x80');
+	fillxy(1, 24, 40, '\x80');
+
+	// Title & author
+	putstrxy(2, 1, titleStr);
+	putstrxy(27, 24, authorStr);
+
+	// Info
+	drawFrame(1,2, 40,7);
+	putstrxy(3,3, infoMachineStr);
+	putstrxy(3,4, infoCpuTypeStr);
+	putstrxy(3,5, "CPU Speed : --         ---%");
+	putstrxy(3,6, infoVdpTypeStr);
+
+	// Graph & axis X
+	cvlinexy(GR_X,GR_Y, GR_H);
+	fillxy(GR_X,GR_Y+GR_H, 1, FRAME_DOWN_LEFT);
+	for (i=1; i<7; i++) {
+		putlinexy(GR_X+i*5-4,GR_Y+GR_H, 5, "\x91\x91\x91\x91\x8f");
+		putstrxy(GR_X-1+i*5,GR_Y+GR_H+1, axisXLabelsStr[i-1]);
+	}
+
+	// Y labels
+	for (i=0; i<9; i++) {
+		putlinexy(GR_X+1, GR_Y+i, 30, speedLineStr);
+		putstrxy(LABELSY_X, GR_Y+i, axisYLabelsStr[i]);
+	}
+
+	// Information
+	putstrxy(3,20, info1Str);
+	putstrxy(3,21, info2Str);
+	putstrxy(28, 23, "[ESC] to exit");
+}
+
+
+// ========================================================
+// RLE: 0x01-0x7f n literals follow, 0x80-0xff next byte repeated n-0x7e times, 0x00 end
+static void printPacked(const char *name, const uint8_t *data, int size)
+{
+	static uint8_t packed[ROWS*80*2];
+	int i = 0, run, lit, out = 0;
+
+	while (i < size) {
+		for (run=1; i+run < size && run < 129 && data[i+run] == data[i]; run++);
+		if (run >= 3) {
+			packed[out++] = run + 0x7e;
+			packed[out++] = data[i];
+			i += run;
+			continue;
+		}
+		for (lit=0; i+lit < size && lit < 127; lit++) {
+			if (i+lit+2 < size && data[i+lit] == data[i+lit+1] && data[i+lit] == data[i+lit+2]) break;
+		}
+		packed[out++] = lit;
+		memcpy(&packed[out], &data[i], lit);
+		out += lit;
+		i += lit;
+	}
+	packed[out++] = 0;
+
+	printf("static const uint8_t %s[%d] = {\t// %d bytes unpacked", name, out, size);
+	for (i=0; i<out; i++) {
+		printf("%s0x%02x", i == 0 ? "\n\t" : i % 16 ? "," : ",\n\t", packed[i]);
+	}
+	printf("\n};\n\n");
+}
+
+int main(int argc, char **argv)
+{
+	cols = argc > 1 ? atoi(argv[1]) : 0;
+	if (cols != 80 && cols != 40) {
+		fprintf(stderr, "Usage: %s 80|40\n", argv[0]);
+		return 1;
+	}
+
+	memset(names, ' ', sizeof(names));
+	if (cols == 80) panel80(); else panel40();
+
+	printf("// Generated by bin/panelimage.c: do not edit\n");
+	printf("#pragma once\n\n");
+	printf("#define PANEL%d_NAMES_SIZE\t%d\n", cols, ROWS*cols);
+	if (cols == 80) {
+		printf("#define PANEL80_BLINK_SIZE\t%d\n", ROWS*80/8);
+	}
+	printf("\n");
+	printf("// Name table of the static panel in %d columns\n", cols);
+	printPacked(cols == 80 ? "panel80Names" : "panel40Names", names, ROWS*cols);
+	if (cols == 80) {
+		printf("// Blink table of the static panel in 80 columns\n");
+		printPacked("panel80Blink", blink, ROWS*80/8);
+	}
+	return 0;
+}
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Generates the lookup table of the partial cell glyphs of the speed bars.
+# A bar cell is divided in SPEEDGLYPH_STEPS positions, and each one maps to
+# one of the 7 growing glyphs 0x88..0x8e (see patterns.h).
+STEPS=50
+GLYPHS=7
+
+awk -v steps=$STEPS -v glyphs=$GLYPHS 'BEGIN {
+	print "// Generated by bin/speedglyphs.sh: do not edit"
+	print "#pragma once"
+	print ""
+	print "#define SPEEDGLYPH_STEPS\t" steps
+	print ""
+	printf "static const char speedGlyph[SPEEDGLYPH_STEPS] = {"
+	for (i = 0; i < steps; i++) {
+		g = int((i * glyphs + steps - 1) / steps) - 1;
+		if (g < 0) g = 0;
+		printf "%s\x27\\x%02x\x27", (i == 0 ? "\n\t" : i % 10 ? ", " : ",\n\t"), 136 + g
+	}
+	print "\n};"
+}'
@@ -4,9 +4,71 @@
 #define PROGRAM_VERSION		"1.4.2"
 #define TESTLOOP_VERSION	"5"
 
-#define MSX_CLOCK			((float)3.579545455f)	// MHz
+#define MSX_CLOCK			3579545UL	// Hz
 
-#define LOOP2				10
+#define LOOP2				10			// Default test loop length
+#define TESTLOOP_CYCLES		1511822UL	// T-states of one test loop in a MSX Z80
+
+#define ADAPT_PRECISION		10			// Adaptive loop target precision (units of 0.01%)
+#define ADAPT_BUDGET		5			// Adaptive loop time budget (seconds)
+#define STATS_RUNS			8			// Test repetitions for the statistics in Debug mode
+#define SWEEP_RUNS			3			// Test repetitions for each turbo mode in Sweep mode
+#define SWEEP_SETTLE		30			// Frames waited after changing the turbo mode
+#define TIMING_UNCERTAINTY	6554UL		// Uncertainty of a measurement in interrupts (0.1, fixed point 16.16)
+#define LINES_UNCERTAINTY	524UL		// Uncertainty using the scanlines timing (~2 scanlines)
+
+#define INTS_x1E4(x)		(((x) >> 16) * 10000UL + (((x) & 0xffff) * 10000UL >> 16))	// Interrupts 16.16 to x1e4
+
+#define NTSC_FPS			3927097UL	// VDP frame rates: 59.922743Hz (fixed point 16.16)
+#define PAL_FPS				3287218UL	//                  50.158969Hz
+
+#define RTC_CALIB_SECONDS	4				// Seconds measured to calibrate the frame rate with the RTC
+#define RTC_CALIB_TOLERANCE	50				// Max deviation of the calibrated frame rate (1/50 = 2%)
+
+#define TRTIMER_CLOCK		3579545UL		// TurboR S1990 timer frequency: 3579545/14 Hz
+#define TRTIMER_DIVIDER		14
+#define NTSC_TRTIMER_TICKS	4266857UL		// TurboR timer ticks by VDP frame (fixed point 1e3)
+#define PAL_TRTIMER_TICKS	5097429UL
 
 #define NTSC_LINES			525
 #define PAL_LINES			625
+#define NTSC_FRAME_LINES	262			// Scanlines by VDP frame
+#define PAL_FRAME_LINES		313
+
+// Platform identifiers
+#define MSX_1				0			// MSX version of the BIOS ROM
+#define MSX_2				1
+#define MSX_2P				2
+#define MSX_TR				3
+
+#define CPU_Z80				0
+#define CPU_R800			1
+#define CPU_Z280			2
+
+#define TR_Z80				0			// The system is running in Z80 mode.
+#define TR_R800_ROM			1			// The system is running in R800 ROM mode.
+#define TR_R800_DRAM		2			// The system is running in R800 DRAM mode.
+
+#define VDP_TMS9918A		0
+#define VDP_V9938			1
+#define VDP_V9958			2
+
+#define BRAND_OCMPLD		27			// machineBrand after the I/O port $40 brands
+#define OCM_SPEEDS			9			// OCM speeds in ocmSmartCmd[]
+
+#define TIMING_VBLANK		0
+#define TIMING_LINES		1
+#define TIMING_TRTIMER		2
+#define TIMING_ENGINES		3
+
+// Detection probes (timed in detect.c, shown by the 'd' mode)
+#define PROBE_VDP			0
+#define PROBE_CPU			1
+#define PROBE_TURBOPANA		2
+#define PROBE_TURBOR		3
+#define PROBE_OCM			4
+#define PROBE_TIDES			5
+#define PROBE_BRAND			6
+#define PROBE_NMOS			7
+#define PROBE_RTC			8
+#define PROBE_COUNT			9
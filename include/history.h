@@ -0,0 +1,57 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+
+// ========================================================
+//  Results history
+//
+//  Every finished measurement is appended as a fixed size record to a log
+//  file in the current drive, shared by both binaries. The machine is
+//  identified by the BIOS ROM fingerprint of the platform detection, and
+//  the 'h' command line mode lists its records (see cmdline.c).
+
+#define HISTORY_FILE		"Z80BENCH.LOG"
+#define HISTORY_VERSION		1
+
+#define HIST_BASELINE		0x01		// Record marked as baseline (/B option)
+#define HIST_NTSC			0x02
+
+// Turbo mode of a record: device << 4 | setting
+#define TURBO_NONE			0
+#define TURBO_PANA			1			// Off/On
+#define TURBO_TR			2			// TR_Z80, TR_R800_ROM, TR_R800_DRAM
+#define TURBO_OCM			3			// Index of ocmSmartCmd[]
+#define TURBO_TIDES			4			// TIDES_3_57MHZ..TIDES_20MHZ
+#define TURBO_CODE(device, setting)	((device) << 4 | (setting))
+
+typedef struct {
+	uint8_t  version;		// HISTORY_VERSION
+	uint16_t romSum;		// Machine fingerprint
+	uint8_t  msxVersion;
+	uint8_t  brand;
+	uint16_t year;
+	uint8_t  month;
+	uint8_t  day;
+	uint8_t  hours;
+	uint8_t  minutes;
+	char     mode;			// G(UI) or the command line mode (D, A, K, S, C, J)
+	uint8_t  flags;
+	uint8_t  kernel;
+	uint8_t  timing;
+	uint8_t  loops;
+	uint8_t  turbo;
+	uint32_t ints;			// Interrupts of the last test (fixed point 16.16)
+	uint16_t rest;			// counterRestHL of the last test
+	uint32_t freq;			// Hz
+} History_t;
+
+uint8_t historyTurbo();
+uint8_t ocmSpeedIndex();
+void historyAdd(char mode, uint8_t turbo, uint32_t freq, uint8_t flags);
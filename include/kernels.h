@@ -0,0 +1,52 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+
+// ========================================================
+//  Instruction-mix test kernels
+//
+//  Each kernel is a naked routine that executes a fixed block of instructions
+//  and returns. The test harness in doInterruptLoop() calls it 'blocks' times
+//  per test loop, so the T-states of a full test loop on a standard MSX Z80
+//  (with the M1 wait state) are known in advance and used as reference.
+
+#define KERNEL_DECHL		0		// Classic TestLoop (dec hl / cp h / jp nz)
+#define KERNEL_ALU			1		// 8-bit ALU register ops
+#define KERNEL_MEMORY		2		// Memory load/store
+#define KERNEL_BLOCKMOVE	3		// LDIR/LDI block moves
+#define KERNEL_STACK		4		// PUSH/POP
+#define KERNEL_INDEXED		5		// IX/IY indexed access
+#define KERNEL_IO			6		// I/O instructions
+#define KERNEL_MUL			7		// R800 MULUB/MULUW
+#define KERNEL_COUNT		8
+
+#define KFLAG_R800_ONLY		0b00000001
+
+// T-states added by the harness for each kernel call, and for each test loop
+#define HARNESS_BLOCK_CYCLES	69
+#define HARNESS_LOOP_CYCLES		56
+
+// T-states spent by the interrupt routine for each VDP interrupt, including
+// the keyboard scan when no new key is pressed
+#define ISR_KEYS_CYCLES			237
+#define ISR_CYCLES				(140+ISR_KEYS_CYCLES)
+
+typedef struct {
+	const char *name;		// Short name shown in the panels
+	void (*run)();			// Kernel block routine (NULL for KERNEL_DECHL)
+	uint16_t blockCycles;	// T-states of one block in a standard MSX Z80
+	uint16_t blocks;		// Blocks executed per test loop
+	uint8_t  flags;
+} Kernel_t;
+
+extern const Kernel_t kernels[KERNEL_COUNT];
+
+bool kernelIsAvailable(uint8_t idx, bool isR800);
+uint32_t kernelLoopCycles(uint8_t idx);
@@ -0,0 +1,49 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "dos.h"
+
+
+// ========================================================
+//  Memory throughput & execution speed profiler
+//
+//  Reads, writes and LDIR copies are timed on the RAM switched in page 2,
+//  either a mapper segment or the page 2 of a slot, counting the test blocks
+//  done in MEMPROF_FRAMES frames with the interrupts disabled (VDP S#0 is
+//  polled). The first MEMPROF_SIZE bytes are saved and restored around the
+//  tests. Like samples.c this code must stay resident (see overlay.h).
+
+#define MEMPROF_PAGE		2
+#define MEMPROF_ADDR		0x8000
+#define MEMPROF_SIZE		512			// Bytes touched by the tests
+#define MEMPROF_FRAMES		16			// Frames timed by each test
+
+#define MEMPROF_READ		0
+#define MEMPROF_WRITE		1
+#define MEMPROF_LDIR		2
+#define MEMPROF_TESTS		3
+
+// Bytes transferred by each test block, and its T-states in a standard MSX
+// Z80 (with the M1 wait state) including the timing loop
+#define MEMPROF_BLOCK_BYTES		256
+#define MEMPROF_READ_CYCLES		6990
+#define MEMPROF_WRITE_CYCLES	6990
+#define MEMPROF_LDIR_CYCLES		5980
+
+// Execution speed: memprofCalls() counts the calls to a loop in RAM or ROM
+// done in MEMPROF_FRAMES frames, with BC = count, using CALSLT unless the
+// slot is MEMPROF_LOCAL. The loop may be in page 2.
+#define MEMPROF_LOCAL			0xff
+
+extern uint16_t memprofBlocks[MEMPROF_TESTS];
+extern uint8_t  memprofCode[8];
+
+bool memprofSlot(uint8_t slot);
+void memprofSegment(MAPPER_Segment *segment);
+uint16_t memprofCalls(uint8_t slot, uint16_t address, uint16_t count) __sdcccall(0);
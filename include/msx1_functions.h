@@ -7,6 +7,18 @@ void msx1_drawCpuSpeed();
 void msx1_drawPanel();
 void msx1_showCPUtype();
 void msx1_showVDPtype();
+void msx1_showKernel();
+void msx1_showLoopMode();
 
 void msx1_textattr(uint16_t attr) __z88dk_fastcall;
-void msx1_textblink(uint8_t x, uint8_t y, uint16_t length, bool enabled);
+
+
+// The MSX1 binary (-D_MSX1_) uses these functions as its UI
+#ifdef _MSX1_
+	#define drawCpuSpeed	msx1_drawCpuSpeed
+	#define drawPanel		msx1_drawPanel
+	#define showCPUtype		msx1_showCPUtype
+	#define showVDPtype		msx1_showVDPtype
+	#define showKernel		msx1_showKernel
+	#define showLoopMode	msx1_showLoopMode
+#endif
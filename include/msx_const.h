@@ -44,7 +44,9 @@ __sfr __at (0x99) IO_VDP2;
 // http://map.grauw.nl/resources/msxbios.php
 //
 #define RDSLT	0x00c		// Reads value of address in another slot
+#define WRSLT	0x014		// Writes value to an address in another slot [Input: A-Slot ID | HL-Address | E-Value][Changes: AF, BC, D][Interrupts disabled]
 #define CALSLT 	0x01c		// Executes inter-slot call [Input: IY-High byte with slot ID | IX-The address that will be called]
+#define ENASLT	0x024		// Switches a page to another slot [Input: A-Slot ID | H-Bits 6-7 select the page][Changes: All][Interrupts disabled]
 #define INIFNK	0x03e		// Initialises the contents of the function keys [Changes: All]
 #define DISSCR	0x041		// Inhibits the screen display [Changes: AF, BC]
 #define ENASCR	0x044		// Enables the screen display [Changes: AF, BC]
@@ -144,6 +146,7 @@ __sfr __at (0x99) IO_VDP2;
 //                                                      0=Japanese, 1=International
 #define MSXVER		0x002d	// (BYTE) MSX version number. 0=MSX1 1=MSX2 2=MSX2+ 3=TurboR
 #define TRMIDI		0x002e	// (BYTE) Bit0: if 1 then MSX-MIDI is present internally (MSX TurboR only)
+#define RAMAD2		0xf343	// (BYTE) Slot address of the RAM in page 2 (MSX-DOS)
 #define LINL40		0xf3ae	// (BYTE) Width for SCREEN 0 (default 37)
 #define LINLEN		0xf3b0	// (BYTE) Current screen width per line
 #define CRTCNT		0xf3b1	// (BYTE) Number of lines of current screen (default 24)
@@ -183,6 +186,7 @@ __sfr __at (0x99) IO_VDP2;
 // MSX mapped system variables
 
 volatile __at (TPALIM) uint16_t varTPALIMIT;
+volatile __at (RAMAD2) uint8_t  varRAMAD2;
 volatile __at (CLIKSW) uint8_t  varCLIKSW;
 volatile __at (LINL40) uint8_t  varLINL40;
 volatile __at (CRTCNT) uint8_t  varCRTCNT;
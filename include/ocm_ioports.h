@@ -477,3 +477,4 @@ typedef enum {
 
 bool ocm_detectDevice(DeviceId_t devId) __z88dk_fastcall;
 bool ocm_sendSmartCmd(uint8_t cmd) __z88dk_fastcall;
+uint8_t ocm_readPort(uint8_t port) __z88dk_fastcall;
@@ -0,0 +1,47 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+
+// ========================================================
+//  Overlays loaded from disk
+//
+//  Rarely used code is linked apart at OVL_ADDR against the symbols of the
+//  resident binary (see bin/ovlsyms.sh), and loaded on demand from a file
+//  named like the binary with the overlay extension. Each overlay starts
+//  with a jump to its overlayMain(char *arg), whose result is returned by
+//  overlayCall(). An overlay can call another one: the caller is loaded again
+//  before overlayCall() returns to its code.
+//
+//  The overlay area is between the resident program and the heap, which
+//  starts at 0xA000 (see main()). The statics of an overlay are after its
+//  code, so bin/ovlcheck.sh fails the link of an overlay that ends past the
+//  heap, and overlayCall() refuses a file that fills the whole area.
+
+#define OVL_ADDR		0x8000
+#define OVL_MAXSIZE		0x2000
+
+#define OVL_DETECT		0		// Platform detection (detect.c)
+#define OVL_CMDLINE		1		// Command line modes (cmdline.c)
+#define OVL_PROFILER	2		// Memory & VDP profilers, called from cmdline.c (profiler.c)
+#define OVL_NONE		0xff
+
+#ifdef _MSX1_
+	#define OVL_NAME	"Z80BMSX1"
+#else
+	#define OVL_NAME	"Z80BMSX2"
+#endif
+
+// Optional platform detection cache, created with the 'c' command line flag
+#define DETECT_CACHE	OVL_NAME".CAP"
+
+uint8_t overlayCall(uint8_t id, char *arg);
+
+// Entry point of each overlay
+uint8_t overlayMain(char *arg);
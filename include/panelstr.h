@@ -0,0 +1,25 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#pragma once
+#include "globals.h"
+
+
+// ========================================================
+//  Panel texts shared by the program and bin/panelimage.c, which renders
+//  the static part of the panels at build time
+
+#define PANEL_TITLE_STR		"\x86 Z80 Frequency Benchmark v"PROGRAM_VERSION" \x87"
+#define PANEL_AUTHOR_STR	"\x86 NataliaPC \x87"
+#define PANEL_MACHINE_STR	"Machine   : "
+#define PANEL_CPUTYPE_STR	"CPU Type  : "
+#define PANEL_VDPTYPE_STR	"VDP Type  : "
+#define PANEL_INFO1_STR		"Clock measurement is approximate."
+#define PANEL_INFO2_STR		"May vary with external RAM mappers."
+
+// Speed bar grid in 80 and 40 columns
+#define PANEL_SPEEDLINE80_STR	"         \x92         \x92         \x92         \x92         \x92         \x92"
+#define PANEL_SPEEDLINE40_STR	"    \x92    \x92    \x92    \x92    \x92    \x92"
@@ -0,0 +1,36 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+
+// ========================================================
+//  Long samples history in memory mapper RAM
+//
+//  A ring buffer of timestamped samples is kept in mapper segments allocated
+//  from MSX-DOS 2, so long soak runs don't use TPA memory. The segments are
+//  switched in page 2, which holds the overlays & heap: this code and its
+//  buffers must stay resident below 0x8000 (see overlay.h).
+
+#define SAMPLES_FILE		"Z80BENCH.CSV"
+#define SAMPLES_PAGE		2
+#define SAMPLES_ADDR		0x8000
+#define SAMPLES_SEGMENTS	16			// Max segments allocated (256KB)
+#define SAMPLES_BY_SEGMENT	2048		// 16KB / sizeof(Sample_t)
+#define SAMPLES_SHIFT		11			// log2(SAMPLES_BY_SEGMENT)
+
+typedef struct {
+	uint32_t seconds;		// Seconds since samplesInit()
+	uint32_t freq;			// Hz
+} Sample_t;
+
+uint16_t samplesInit();
+void samplesFree();
+void samplesAdd(uint32_t freq);
+uint16_t samplesCount();
+bool samplesExport();
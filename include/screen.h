@@ -0,0 +1,54 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+
+// ========================================================
+//  Retained model of the dynamic panel fields
+//
+//  Each region keeps a copy of the text already in VRAM. screenUpdate() only
+//  stores the new text, and screenFlush() uploads the cells and blink bits
+//  that differ from VRAM.
+//
+//  In 80 columns (MSX2 or higher binary) two name & blink tables are kept in VRAM.
+//  screenFlush() draws into the hidden page and the H.TIMI hook shows it by
+//  changing R#2/R#3 in the next VBLANK, so there is no wait for the VBLANK.
+//  The hook writes the VDP registers, so any other VRAM access must wait for
+//  the pending flip first (screenWaitFlip()), and any direct write to the
+//  visible page must be followed by screenSync().
+
+#define SCR_COUNTER		0		// Interrupts counter in the border
+#define SCR_PERCENT		1		// % of a MSX Z80
+#define SCR_MHZ			2		// CPU speed in the info panel
+#define SCR_SPEEDLINE	3		// CPU speed bar
+#define SCR_STATSLINE	4		// Statistics below the speed bar
+#define SCR_CHECKLINE	5		// VBLANK cross-check of the TurboR timer
+#define SCR_REGIONS		6
+
+#define SCR_MAXLEN		60
+
+void screenInvalidate();
+void screenForget(uint8_t region);
+void screenUpdate(uint8_t region, uint8_t x, uint8_t y, uint8_t len, const char *str);
+void screenBlink(uint8_t region, uint8_t len);
+void screenFlush();
+
+#ifdef _MSX1_
+	#define SCR_PAGES		1
+	#define screenPagesInit()
+	#define screenPagesRestore()
+	#define screenWaitFlip()
+	#define screenSync()
+#else
+	#define SCR_PAGES		2
+	void screenPagesInit();
+	void screenPagesRestore();
+	void screenWaitFlip();
+	void screenSync();
+#endif
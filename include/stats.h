@@ -0,0 +1,37 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+
+// ========================================================
+//  Repeated-run statistics
+//
+//  Keeps the last STATS_SAMPLES measured frequencies (in Hz) and summarizes
+//  them. Samples far away from the median (disk access, interrupts from other
+//  devices...) are rejected using the Median Absolute Deviation before the
+//  rest of the values are calculated.
+
+#define STATS_SAMPLES		16
+#define STATS_MAD_FACTOR	5		// Reject samples beyond median ± 5*MAD (~3.4 sigma)
+#define STATS_MAD_MIN		10000	// Minimum rejection window: median/10000 (0.01%)
+
+typedef struct {
+	uint8_t  total;			// Samples in the buffer
+	uint8_t  count;			// Samples used after outlier rejection
+	uint32_t min;			// Hz
+	uint32_t max;			// Hz
+	uint32_t median;		// Hz
+	uint32_t mean;			// Hz
+	uint32_t stddev;		// Hz
+	uint32_t ci95;			// Hz (half width of the 95% confidence interval)
+} Stats_t;
+
+void statsReset();
+void statsAdd(uint32_t freq);
+void statsCalculate(Stats_t *stats);
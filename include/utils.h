@@ -14,15 +14,21 @@
 
 
 uint8_t getRomByte(uint16_t address) __sdcccall(1);
+uint8_t readSlot(uint8_t slot, uint16_t address) __sdcccall(0);
+void writeSlot(uint8_t slot, uint16_t address, uint8_t value) __sdcccall(0);
 void click();
 void die(const char *s, ...);
 void exit(void);
+void dosPuts(const char *str) __sdcccall(1);
 
 
 void basic_play(void *parameters) __sdcccall(1);
 
 
 char *formatFloat(float value, char *txt, int8_t decimals);
+char *formatFixed(uint32_t value, char *txt, uint8_t decimals);
+uint32_t mulDiv(uint32_t a, uint32_t b, uint32_t c);
+uint8_t *rleUnpack(const uint8_t *src, uint8_t *dst);
 
 
 #define MODE_ANK		0
@@ -40,6 +46,7 @@ bool detectZ280() __sdcccall(0);
 bool detectNMOS() __sdcccall(1);
 bool detectTurboPana() __z88dk_fastcall;
 bool setTurboPana(bool enabled) __sdcccall(1);
+bool getTurboPana() __sdcccall(1);
 bool detectTurboR() __z88dk_fastcall;
 void setCpuTurboR(uint8_t mode) __z88dk_fastcall;
 uint8_t getCpuTurboR() __sdcccall(1);
@@ -52,9 +59,17 @@ void setNTSC(bool enabled) __sdcccall(1);
 #define TIDES_SLOTS357	4
 bool detectTidesRider() __sdcccall(1);
 void setTidesSpeed(uint8_t speed) __z88dk_fastcall;
-
+uint8_t getTidesSpeed() __sdcccall(1);
+
+#define RTC_SECONDS_UNITS	0
+#define RTC_SECONDS_TENS	1
+#define RTC_MODE			13
+#define RTC_MODE_ENABLES	0b00001100	// Alarm & timer enable bits of the mode register
+#define RTC_TIMER_ENABLE	0b00001000
+bool detectRTC();
 uint8_t getRegisterRTC(uint8_t reg, uint8_t block);
 void setRegisterRTC(uint8_t reg, uint8_t block, uint8_t value);
+uint8_t getModeRTC();
 
 
 #endif//__UTILS_H__
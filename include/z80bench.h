@@ -1,21 +1,19 @@
 #include <stdint.h>
 #include "globals.h"
+#include "panelstr.h"
 
 
 // ========================================================
 
-const char titleStr[] = "\x86 Z80 Frequency Benchmark v"PROGRAM_VERSION" \x87";
-const char authorStr[] = "\x86 NataliaPC \x87";
-const char infoMachineStr[] = "Machine   : ";
-const char infoCpuTypeStr[] = "CPU Type  : ";
-const char infoVdpTypeStr[] = "VDP Type  : ";
+const char titleStr[] = PANEL_TITLE_STR;
+const char authorStr[] = PANEL_AUTHOR_STR;
+const char infoMachineStr[] = PANEL_MACHINE_STR;
+const char infoCpuTypeStr[] = PANEL_CPUTYPE_STR;
+const char infoVdpTypeStr[] = PANEL_VDPTYPE_STR;
 
 static const char *axisXLabelsStr[] = {
 	" 5MHz", "10MHz", "15MHz", "20MHz", "25MHz", "  30"
 };
-static const char *axisYLabelsStr[] = {
-	"", "CPU speed", "(MHz)", "", "MSX standard", "(3.579MHz)", "", "MSX2+ tPANA", "(5.369MHz)"
-};
 
 const char *cpuTypesStr[] = {
 	"Z80 ", "R800", "Z280"
@@ -25,14 +23,11 @@ const char *cmosStr[] = {
 	"CMOS", "NMOS"
 };
 
-#define VDP_TMS9918A	0
-#define VDP_V9938		1
-#define VDP_V9958		2
 const char *vdpTypeStr[] = {
 	"TMS9918A", "V9938", "V9958"
 };
 
-static const char *turboRmodeStr[] = {
+const char *turboRmodeStr[] = {
 	"", "ROM", "DRAM"
 };
 
@@ -45,7 +40,6 @@ const char *machineTypeStr[] = {
 	"MSX1", "MSX2", "MSX2+", "MSX TurboR"
 };
 
-#define BRAND_OCMPLD	27
 const char *machineBrandStr[] = {
 	// [0] Unknown
 	"",
@@ -57,18 +51,28 @@ const char *machineBrandStr[] = {
 	"OCM/MSX++"
 };
 
-static const char *speedLineStr = "         \x92         \x92         \x92         \x92         \x92         \x92";
-const char *info1Str = "Clock measurement is approximate.";
-const char *info2Str = "May vary with external RAM mappers.";
+static const char *speedLineStr = PANEL_SPEEDLINE80_STR;
+const char *timingEngineStr[] = {
+	"VBLANK", "Lines", "Timer"
+};
 
+const char *info1Str = PANEL_INFO1_STR;
+const char *info2Str = PANEL_INFO2_STR;
 
-static const float speedDecLimits[] = { .07f, .14f, .21f, .28f, .35f, .42f, .5f };
 
-static const uint8_t ocmSmartCmd[] = {
+const uint8_t ocmSmartCmd[OCM_SPEEDS] = {
 	OCM_SMART_CPU358MHz, OCM_SMART_TurboPana, OCM_SMART_CPU410MHz, OCM_SMART_CPU448MHz, OCM_SMART_CPU490MHz,
 	OCM_SMART_CPU539MHz, OCM_SMART_CPU610MHz, OCM_SMART_CPU696MHz, OCM_SMART_CPU806MHz
 };
 
+// Turbo settings names, in the order of ocmSmartCmd[] and TIDES_*
+const char *ocmSpeedsStr[OCM_SPEEDS] = {
+	"3.58MHz", "tPANA", "4.10MHz", "4.48MHz", "4.90MHz", "5.39MHz", "6.10MHz", "6.96MHz", "8.06MHz"
+};
+const char *tidesSpeedsStr[] = {
+	"3.57MHz", "6.66MHz", "10MHz", "20MHz"
+};
+
 
 // ========================================================
 
@@ -80,7 +84,6 @@ void _copyRAMtoVRAM(uint16_t memory, uint16_t vram, uint16_t size) __sdcccall(0)
 
 void abortRoutine();
 void restoreScreen();
-uint8_t detectMachineBrand();
 bool detectTurboR() __z88dk_fastcall;
 uint8_t detectCPUtype();
 
@@ -0,0 +1,772 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+
+	Overlay: command line modes (see overlay.h)
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "globals.h"
+#include "msx_const.h"
+#include "heap.h"
+#include "dos.h"
+#include "conio.h"
+#include "utils.h"
+#include "kernels.h"
+#include "stats.h"
+#include "ocm_ioports.h"
+#include "history.h"
+#include "samples.h"
+#include "overlay.h"
+
+
+// ========================================================
+extern const char titleStr[];
+extern const char authorStr[];
+extern const char infoMachineStr[];
+extern const char infoCpuTypeStr[];
+extern const char infoVdpTypeStr[];
+extern const char *machineTypeStr[];
+extern const char *machineBrandStr[];
+extern const char *cpuTypesStr[];
+extern const char *cmosStr[];
+extern const char *turboRmodeStr[];
+extern const char *vdpTypeStr[];
+extern const char *vdpModesStr[];
+extern const char *timingEngineStr[];
+extern const char *ocmSpeedsStr[OCM_SPEEDS];
+extern const char *tidesSpeedsStr[];
+
+extern uint8_t  msxVersionROM;
+extern uint8_t  machineBrand;
+extern uint8_t  cpuType;
+extern bool     isCMOS;
+extern uint8_t  turboRmode;
+extern bool     turboRdetected;
+extern uint8_t  vdpType;
+extern bool     isNTSC;
+extern uint32_t int_counter;
+extern uint16_t counterRestHL;
+extern uint32_t calculatedFreq;
+extern uint32_t vblankFreq;
+extern uint16_t speedCentiMhz;
+extern uint16_t speedPercent;
+extern char    *floatStr;
+extern uint8_t  loopCount;
+extern bool     adaptiveLoop;
+extern uint16_t adaptPrecision;
+extern uint8_t  adaptBudget;
+extern uint8_t  timingEngine;
+extern uint8_t  kernelIdx;
+extern uint32_t frameRate[2];
+extern bool     rtcDetected;
+extern bool     rtcCalibrated;
+extern uint8_t  rtcSeconds;
+extern Stats_t  stats;
+extern bool     turboPanaDetected;
+extern bool     ocmDetected;
+extern bool     tidesDetected;
+extern const uint8_t ocmSmartCmd[OCM_SPEEDS];
+extern char   **argValues;
+extern uint8_t  argCount;
+extern uint16_t machineFingerprint;
+extern bool     keyAbort;
+extern bool     testAborted;
+extern uint16_t probeTicks[PROBE_COUNT];
+extern bool     detectCached;
+
+bool isTimingAvailable(uint8_t engine);
+bool detectNTSC();
+uint8_t detectCPUtype();
+void selectKernel(uint8_t idx);
+void doInterruptLoop();
+void calculateCounterRest();
+void calculateMhz();
+void adaptLoopCount();
+void updateSpeedDisplay();
+void waitVBLANK();
+void readKeyEvents();
+uint32_t calibrateFrameRate();
+char *formatFrameRate(char *str, uint32_t fps);
+char *formatStats(char *str, bool compact);
+
+
+// Machine-readable records (fields are documented in README.md)
+static const char csvFmt[] = "%s,%s,%s,%s,%s,%s,%s,%lu,%u,%s,%u\n";
+static const char jsonFmt[] = "{\"machine\":\"%s\",\"brand\":\"%s\",\"cpu\":\"%s\",\"z80\":\"%s\","
+	"\"vdp\":\"%s\",\"video\":\"%s\",\"turbo\":\"%s\",\"ints\":%lu,\"residual\":%u,\"mhz\":%s,\"percent\":%u}\n";
+static const char *cpuNamesStr[] = {
+	"Z80", "R800", "Z280"
+};
+static const char *turboNamesStr[] = {
+	"Z80", "R800 ROM", "R800 DRAM"
+};
+
+// Parsed command line (see commandLineOptions())
+#define OUTPUT_TEXT			0
+#define OUTPUT_CSV			1
+#define OUTPUT_JSON			2
+
+static const char modesStr[] = "DAKSHWMEPVI";
+static char     mode = 'D';			// One of modesStr
+static uint8_t  outputFormat = OUTPUT_TEXT;
+static char    *modifiers = "";
+static uint8_t  repeats = 0;		// 0: default of the mode
+static uint8_t  kernelOption = KERNEL_DECHL;
+static bool     quiet = false;
+static uint8_t  historyFlags = 0;	// Flags of the records added to the history
+
+
+static const char *probeNamesStr[PROBE_COUNT] = {
+	"VDP", "CPU", "tPANA", "TurboR", "OCM", "Tides", "Brand", "NMOS", "RTC"
+};
+
+
+// ========================================================
+// Exit code for MSX-DOS 2 batch files
+static uint8_t roundedMhz(uint32_t freq)
+{
+	return (freq + 500000UL) / 1000000UL;
+}
+
+static uint8_t commandLineRecord(bool json)
+{
+	doInterruptLoop();
+	uint32_t ints = int_counter;
+	uint16_t rest = counterRestHL;
+	calculateCounterRest();
+	calculateMhz();
+	updateSpeedDisplay();
+	formatFixed(calculatedFreq, floatStr, 6);
+
+	csprintf(heap_top, json ? jsonFmt : csvFmt,
+		machineTypeStr[msxVersionROM], machineBrandStr[machineBrand],
+		cpuNamesStr[cpuType], cpuType == CPU_Z80 ? cmosStr[isCMOS] : "",
+		vdpTypeStr[vdpType], isNTSC ? "NTSC" : "PAL",
+		turboRdetected ? turboNamesStr[turboRmode] : "",
+		ints, rest, floatStr, speedPercent);
+	dosPuts(heap_top);
+	historyAdd(mode, historyTurbo(), calculatedFreq, historyFlags);
+
+	return roundedMhz(calculatedFreq);
+}
+
+static void commandLineProbes()
+{
+	uint16_t total = 0;
+
+	if (detectCached) {
+		cputs("Detection : from "DETECT_CACHE"\n");
+		return;
+	}
+	// Tenths of ms = frames (8.8) * 10000 / fps (16.16)
+	cputs("Probes ms :");
+	for (uint8_t i=0; i<PROBE_COUNT; i++) {
+		formatFixed(mulDiv(probeTicks[i], 2560000UL, frameRate[isNTSC]), floatStr, 1);
+		cprintf(" %s:%s", probeNamesStr[i], floatStr);
+		total += probeTicks[i];
+	}
+	formatFixed(mulDiv(total, 2560000UL, frameRate[isNTSC]), floatStr, 1);
+	cprintf("\nDetection : %s ms\n", floatStr);
+}
+
+static void commandLineInfo()
+{
+	// Machine type
+	cputs(infoMachineStr);
+	if (machineBrand == 0) {
+		cprintf("%s\n", machineTypeStr[msxVersionROM]);
+	} else {
+		cprintf("%s (%s)\n", machineTypeStr[msxVersionROM], machineBrandStr[machineBrand]);
+	}
+	// CPU type
+	cputs(infoCpuTypeStr);
+	if (turboRmode) {
+		cprintf("%s (%s)", cpuTypesStr[cpuType], turboRmodeStr[turboRmode]);
+	} else {
+		if (cpuType == CPU_Z80) {
+			cprintf("%s(%s)", cpuTypesStr[cpuType], cmosStr[isCMOS]);
+		} else {
+			cputs(cpuTypesStr[cpuType]);
+		}
+	}
+	putch('\n');
+	// Video mode
+	cputs(infoVdpTypeStr);
+	cprintf("%s %s\n", vdpTypeStr[vdpType], vdpModesStr[detectNTSC()]);
+	// Detection probes
+	commandLineProbes();
+}
+
+static void commandLineKernels()
+{
+	uint8_t turbo = historyTurbo();
+
+	if (!quiet) cputs("Running kernel suite:\n");
+	for (uint8_t i=0; i<KERNEL_COUNT; i++) {
+		cprintf("  %s", kernels[i].name);
+		for (uint8_t j=strlen(kernels[i].name); j<12; j++) putch(' ');
+		if (!kernelIsAvailable(i, cpuType == CPU_R800)) {
+			cputs(": R800 only\n");
+			continue;
+		}
+		selectKernel(i);
+		doInterruptLoop();
+		calculateCounterRest();
+		calculateMhz();
+		updateSpeedDisplay();
+		formatFixed(speedCentiMhz, floatStr, 2);
+		cprintf(": %s MHz  %u%%\n", floatStr, speedPercent);
+		historyAdd('K', turbo, calculatedFreq, historyFlags);
+	}
+	selectKernel(KERNEL_DECHL);
+}
+
+static void optionError(const char *error, char *opt)
+{
+	cputs(error);
+	cputs(opt);
+	die("\n");
+}
+
+// Value of an option like "/X:123"
+static uint8_t optionValue(char *opt, uint8_t min, uint8_t max)
+{
+	uint16_t value = 0;
+	char *p = &opt[3];
+
+	if (opt[2] != ':' || !*p) optionError("Invalid option: ", opt);
+	for (; *p; p++) {
+		if (*p < '0' || *p > '9') optionError("Invalid option: ", opt);
+		value = value * 10 + *p - '0';
+		if (value > max) optionError("Invalid option: ", opt);
+	}
+	if (value < min) optionError("Invalid option: ", opt);
+	return value;
+}
+
+static void optionAvailable(bool available, char *opt)
+{
+	if (!available) optionError("Not available: ", opt);
+}
+
+// The mode is the first argument, and the rest are '/' options. The turbo
+// options are applied at once, and stay selected when the program ends.
+static void commandLineOptions()
+{
+	char *opt;
+	uint8_t value;
+
+	for (uint8_t i=0; i<argCount; i++) {
+		opt = argValues[i];
+		for (char *p = opt; *p; p++) {
+			if (*p >= 'a' && *p <= 'z') *p -= 'a' - 'A';
+		}
+		if (opt[0] != '/') {
+			if (i) optionError("Invalid option: ", opt);
+			mode = opt[0];
+			modifiers = &opt[1];
+			continue;
+		}
+		if (!strcmp(opt, "/CSV")) {
+			outputFormat = OUTPUT_CSV;
+			continue;
+		}
+		if (!strcmp(opt, "/JSON")) {
+			outputFormat = OUTPUT_JSON;
+			continue;
+		}
+		switch (opt[1]) {
+			// Test repetitions
+			case 'R':
+				repeats = optionValue(opt, 1, 255);
+				break;
+			// Test loop length
+			case 'L':
+				loopCount = optionValue(opt, 1, 255);
+				break;
+			// Test kernel (checked when the CPU is known)
+			case 'K':
+				kernelOption = optionValue(opt, 0, KERNEL_COUNT-1);
+				break;
+			// tPANA off/on
+			case 'P':
+				optionAvailable(turboPanaDetected, opt);
+				setTurboPana(optionValue(opt, 0, 1));
+				break;
+			// TurboR CPU mode
+			case 'T':
+				optionAvailable(turboRdetected, opt);
+				turboRmode = optionValue(opt, TR_Z80, TR_R800_DRAM);
+				setCpuTurboR(turboRmode);
+				cpuType = detectCPUtype();
+				isCMOS = detectNMOS();
+				break;
+			// OCM speed
+			case 'O':
+				optionAvailable(ocmDetected, opt);
+				value = optionValue(opt, 0, OCM_SPEEDS-1);
+				ocm_sendSmartCmd(ocmSmartCmd[value]);
+				break;
+			// Tides-Rider speed
+			case 'S':
+				optionAvailable(tidesDetected, opt);
+				value = optionValue(opt, TIDES_3_57MHZ, TIDES_20MHZ);
+				setTidesSpeed(value | TIDES_SLOTS357);
+				break;
+			// Force NTSC/PAL
+			case 'V':
+				if (opt[2] != ':' || (opt[3] != 'N' && opt[3] != 'P') || opt[4]) {
+					optionError("Invalid option: ", opt);
+				}
+				optionAvailable(vdpType >= VDP_V9938, opt);
+				isNTSC = opt[3] == 'N';
+				setNTSC(isNTSC);
+				break;
+			// Mark the results as baseline in the history
+			case 'B':
+				if (opt[2]) optionError("Invalid option: ", opt);
+				historyFlags = HIST_BASELINE;
+				break;
+			// Quiet output
+			case 'Q':
+				if (opt[2]) optionError("Invalid option: ", opt);
+				quiet = true;
+				break;
+			default:
+				optionError("Invalid option: ", opt);
+		}
+	}
+	optionAvailable(kernelIsAvailable(kernelOption, cpuType == CPU_R800), "/K");
+	selectKernel(kernelOption);
+}
+
+static void putPadded(const char *str, uint8_t width)
+{
+	cputs(str);
+	for (uint8_t j=strlen(str); j<width; j++) putch(' ');
+}
+
+// Waits for the new turbo mode and prints a row with its median speed
+static void sweepRow(const char *device, const char *setting, uint8_t turbo)
+{
+	putPadded(device, 7);
+	putPadded(setting, 11);
+	if (!kernelIsAvailable(kernelIdx, cpuType == CPU_R800)) {
+		cputs("R800 only\n");
+		return;
+	}
+	for (uint8_t i=0; i<SWEEP_SETTLE; i++) {
+		waitVBLANK();
+	}
+	statsReset();
+	for (uint8_t i=0; i<repeats; i++) {
+		doInterruptLoop();
+		calculateCounterRest();
+		calculateMhz();
+		statsAdd(calculatedFreq);
+	}
+	statsCalculate(&stats);
+	*(formatFixed(stats.median, floatStr, 6) - 3) = '\0';		// 3 decimals
+	*(formatFixed(stats.ci95, heap_top, 6) - 3) = '\0';
+	cprintf("%s \xf1%s MHz  ", floatStr, heap_top);
+	formatFixed(mulDiv(stats.median, 100, MSX_CLOCK), floatStr, 2);
+	cprintf("x%s\n", floatStr);
+	historyAdd('S', turbo, stats.median, historyFlags);
+}
+
+// ========================================================
+// History view
+
+#define HIST_KEYS			16		// Settings compared in the history view
+#define HIST_ROWS			16		// Last records listed
+
+typedef struct {
+	uint8_t  kernel;
+	uint8_t  turbo;
+	uint32_t baseline;		// Hz of the last baseline record
+	uint32_t last;			// Hz of the previous record
+} HistKey_t;
+
+static History_t histRecord;
+static HistKey_t histKeys[HIST_KEYS];
+static uint8_t   histKeysCount = 0;
+
+// Next record of this machine in the history file
+static bool historyNext()
+{
+	while (fread((char*)&histRecord, sizeof(History_t)) == sizeof(History_t)) {
+		if (histRecord.version == HISTORY_VERSION && histRecord.romSum == machineFingerprint &&
+			histRecord.msxVersion == msxVersionROM && histRecord.brand == machineBrand &&
+			histRecord.kernel < KERNEL_COUNT)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Settings (kernel & turbo mode) of the current record
+static HistKey_t *historyKey()
+{
+	HistKey_t *key = histKeys;
+
+	for (uint8_t i=0; i<histKeysCount; i++, key++) {
+		if (key->kernel == histRecord.kernel && key->turbo == histRecord.turbo) return key;
+	}
+	if (histKeysCount == HIST_KEYS) return NULL;
+	histKeysCount++;
+	key->kernel = histRecord.kernel;
+	key->turbo = histRecord.turbo;
+	key->baseline = key->last = 0;
+	return key;
+}
+
+static char *putDigits(char *str, uint16_t value, uint8_t digits)
+{
+	str += digits;
+	for (char *p = str; digits--; value /= 10) {
+		*--p = '0' + value % 10;
+	}
+	return str;
+}
+
+static void putTurbo(uint8_t turbo)
+{
+	uint8_t setting = turbo & 0x0f;
+
+	switch (turbo >> 4) {
+		case TURBO_PANA:
+			csprintf(heap_top, "tPANA %s", setting ? "On" : "Off");
+			break;
+		case TURBO_TR:
+			csprintf(heap_top, "TR %s", setting ? turboRmodeStr[setting % 3] : "Z80");
+			break;
+		case TURBO_OCM:
+			csprintf(heap_top, "OCM %s", ocmSpeedsStr[setting % OCM_SPEEDS]);
+			break;
+		case TURBO_TIDES:
+			csprintf(heap_top, "Tides %s", tidesSpeedsStr[setting & 3]);
+			break;
+		default:
+			*heap_top = '\0';
+	}
+	putPadded((char*)heap_top, 14);
+}
+
+// Lists the last records of this machine, with the difference from the
+// baseline of the same settings, or else from the previous record
+static void commandLineHistory()
+{
+	uint16_t total = 0, row = 0;
+	uint32_t ref, diff;
+	HistKey_t *key;
+	char *str;
+
+	if (!fopen(HISTORY_FILE)) {
+		cputs(HISTORY_FILE" not found\n");
+		return;
+	}
+	while (historyNext()) {
+		total++;
+		if ((histRecord.flags & HIST_BASELINE) && (key = historyKey())) {
+			key->baseline = histRecord.freq;
+		}
+	}
+	fclose();
+	if (!quiet) cprintf("History of this machine: %u records\n", total);
+
+	fopen(HISTORY_FILE);
+	while (historyNext()) {
+		key = historyKey();
+		ref = key ? (key->baseline ? key->baseline : key->last) : 0;
+		if (key) key->last = histRecord.freq;
+		if (total - row++ > HIST_ROWS) continue;
+
+		str = putDigits((char*)heap_top, histRecord.year, 4);
+		*str++ = '-';
+		str = putDigits(str, histRecord.month, 2);
+		*str++ = '-';
+		str = putDigits(str, histRecord.day, 2);
+		*str++ = ' ';
+		str = putDigits(str, histRecord.hours, 2);
+		*str++ = ':';
+		str = putDigits(str, histRecord.minutes, 2);
+		*str++ = ' ';
+		*str++ = histRecord.mode;
+		*str = '\0';
+		putPadded((char*)heap_top, 19);
+		putPadded(kernels[histRecord.kernel].name, 12);
+		putTurbo(histRecord.turbo);
+
+		*(formatFixed(histRecord.freq, floatStr, 6) - 3) = '\0';		// 3 decimals
+		cprintf("%s MHz ", floatStr);
+		if (ref) {
+			diff = histRecord.freq > ref ? histRecord.freq - ref : ref - histRecord.freq;
+			formatFixed(mulDiv(diff, 10000, ref), floatStr, 2);
+			cprintf("%s%s%%", histRecord.freq >= ref ? "+" : "-", floatStr);
+		}
+		cputs(histRecord.flags & HIST_BASELINE ? " *\n" : "\n");
+	}
+	fclose();
+}
+
+
+// ========================================================
+// Soak test: runs the test until a key is pressed (or /R times), keeping the
+// samples in mapper RAM, and exports them to disk at the end
+static void commandLineSoak()
+{
+	uint16_t capacity = samplesInit();
+
+	if (!capacity) {
+		die("A MSX-DOS 2 memory mapper is needed\n");
+	}
+	if (!quiet) cprintf("Soak test (%u samples buffer): press ESC to stop\n", capacity);
+
+	keyAbort = true;
+	for (uint16_t i=0; !repeats || i<repeats; i++) {
+		doInterruptLoop();
+		if (testAborted) break;
+		calculateCounterRest();
+		calculateMhz();
+		samplesAdd(calculatedFreq);
+		formatFixed(calculatedFreq, floatStr, 6);
+		if (!quiet) cprintf("\r%u: %s MHz   ", samplesCount(), floatStr);
+	}
+	keyAbort = false;
+	readKeyEvents();
+	varPUTPNT = varGETPNT;
+
+	if (!quiet) cprintf("\nSaving %u samples to "SAMPLES_FILE"...\n", samplesCount());
+	if (!samplesExport()) {
+		cputs("Error writing "SAMPLES_FILE"\n");
+	}
+	samplesFree();
+}
+
+
+// ========================================================
+// Measures every turbo mode detected, and then restores the original one
+static void commandLineSweep()
+{
+	uint8_t i, original;
+	bool found = false;
+
+	if (!repeats) repeats = SWEEP_RUNS;
+	if (!quiet) cprintf("Sweeping turbo modes (x%u, kernel %s):\n", repeats, kernels[kernelIdx].name);
+
+	if (turboPanaDetected) {
+		original = getTurboPana();
+		for (i=0; i<2; i++) {
+			setTurboPana(i);
+			sweepRow("tPANA", i ? "On" : "Off", TURBO_CODE(TURBO_PANA, i));
+		}
+		setTurboPana(original);
+		found = true;
+	}
+	if (turboRdetected) {
+		original = turboRmode;
+		for (i=TR_Z80; i<=TR_R800_DRAM; i++) {
+			setCpuTurboR(i);
+			cpuType = detectCPUtype();
+			sweepRow("TurboR", i ? turboRmodeStr[i] : "Z80", TURBO_CODE(TURBO_TR, i));
+		}
+		setCpuTurboR(original);
+		cpuType = detectCPUtype();
+		found = true;
+	}
+	if (ocmDetected) {
+		original = ocmSpeedIndex();
+		for (i=0; i<OCM_SPEEDS; i++) {
+			ocm_sendSmartCmd(ocmSmartCmd[i]);
+			sweepRow("OCM", ocmSpeedsStr[i], TURBO_CODE(TURBO_OCM, i));
+		}
+		ocm_sendSmartCmd(ocmSmartCmd[original]);
+		found = true;
+	}
+	if (tidesDetected) {
+		original = getTidesSpeed();
+		for (i=TIDES_3_57MHZ; i<=TIDES_20MHZ; i++) {
+			setTidesSpeed(i | TIDES_SLOTS357);
+			sweepRow("Tides", tidesSpeedsStr[i], TURBO_CODE(TURBO_TIDES, i));
+		}
+		setTidesSpeed(original);
+		found = true;
+	}
+	if (!found) {
+		sweepRow("Stock", "", TURBO_NONE);
+	}
+}
+
+uint8_t overlayMain(char *arg)
+{
+	uint8_t mhz = 0;
+
+	arg;
+	commandLineOptions();
+
+	// Machine-readable output: only the records are printed
+	if (outputFormat != OUTPUT_TEXT && strchr(modesStr, mode)) {
+		if (!repeats) repeats = 1;
+		while (repeats--) {
+			mhz = commandLineRecord(outputFormat == OUTPUT_JSON);
+		}
+		return mhz;
+	}
+
+	*((char*)&titleStr[strlen(titleStr)-2]) = '\0';
+	*((char*)&authorStr[11]) = '\0';
+	if (!quiet) cprintf("%s (by %s)\n", &titleStr[2], &authorStr[2]);
+
+	if (!strchr(modesStr, mode)) {
+		die("\nz80bench [d|a|k|s|h|w|m|e|p|v|i|/csv|/json] [options]\n\n"
+			"  <none>: Run GUI mode (default)\n"
+			"  d:      Run Command line Debug mode\n"
+			"  a:      Run Debug mode with Adaptive test loop\n"
+			"  k:      Run instruction-mix Kernel suite\n"
+			"  s:      Sweep all the turbo modes\n"
+			"  h:      List the results history\n"
+			"  w:      Soak test saved to "SAMPLES_FILE"\n"
+			"  m:      Memory throughput of slots & mapper segments\n"
+			"  e:      Execution speed by page & slot\n"
+			"  p:      Memory access pattern sweep\n"
+			"  v:      VDP I/O throughput suite\n"
+			"  i:      Minimum safe VDP write interval\n"
+			"  /csv:   Print one CSV record of the test\n"
+			"  /json:  Print one JSON record of the test\n"
+			"Add 'l' to use V99x8 scanlines timing (e.g. 'dl')\n"
+			"Add 't' to use TurboR system timer (e.g. 'dt')\n"
+			"Add 'r' to calibrate the frame rate with RTC (e.g. 'dr')\n"
+			"Add 'c' to probe again and save "DETECT_CACHE" (e.g. 'dc')\n\n"
+			"  /R:n    Test repetitions (1-255)\n"
+			"  /L:n    Test loop length (1-255)\n"
+			"  /K:n    Test kernel (0-7)\n"
+			"  /P:n    tPANA off/on (0-1)\n"
+			"  /T:n    TurboR Z80/R800 ROM/R800 DRAM (0-2)\n"
+			"  /O:n    OCM speed (0-8)\n"
+			"  /S:n    Tides-Rider 3.57/6.66/10/20MHz (0-3)\n"
+			"  /V:N|P  Force NTSC/PAL\n"
+			"  /B      Mark the results as baseline\n"
+			"  /Q      Quiet: only the results\n");
+	}
+	bool rtcCalibration = false;
+	for (char *p = modifiers; *p; p++) {
+		if (*p == 'L' && isTimingAvailable(TIMING_LINES)) {
+			timingEngine = TIMING_LINES;
+		}
+		if (*p == 'T' && isTimingAvailable(TIMING_TRTIMER)) {
+			timingEngine = TIMING_TRTIMER;
+		}
+		if (*p == 'R') {
+			rtcCalibration = true;
+		}
+	}
+
+	if (!quiet) commandLineInfo();
+
+	// Frame rate calibration
+	if (rtcCalibration) {
+		if (!rtcDetected) {
+			cputs("RTC not found: using nominal frame rate\n");
+		} else {
+			if (!quiet) cprintf("Calibrating frame rate with RTC (%us)...\n", rtcSeconds);
+			isNTSC = detectNTSC();
+			if (!calibrateFrameRate()) {
+				cputs("RTC measure out of range: using nominal frame rate\n");
+			} else {
+				cprintf("VDP frame rate: %s\n", formatFrameRate(floatStr, frameRate[isNTSC]));
+			}
+		}
+	}
+
+	if (mode == 'K') {
+		commandLineKernels();
+		return 0;
+	}
+	if (mode == 'S') {
+		commandLineSweep();
+		return 0;
+	}
+	if (mode == 'H') {
+		commandLineHistory();
+		return 0;
+	}
+	if (mode == 'W') {
+		commandLineSoak();
+		return 0;
+	}
+	if (mode == 'M' || mode == 'E' || mode == 'P' || mode == 'V' || mode == 'I') {
+		return overlayCall(OVL_PROFILER, argValues[0]);
+	}
+
+	// CPU speed test
+	if (!quiet) cprintf("Running TestLoop v"TESTLOOP_VERSION" (%s timing):\n", timingEngineStr[timingEngine]);
+
+	if (mode == 'A') {
+		adaptiveLoop = true;
+		loopCount = 1;
+		doInterruptLoop();
+		calculateCounterRest();
+		adaptLoopCount();
+		formatFixed(adaptPrecision, floatStr, 2);
+		if (!quiet) cprintf("Adaptive loop: x%u (target %s%%, budget %us)\n", loopCount, floatStr, adaptBudget);
+	}
+
+	doInterruptLoop();
+	calculateCounterRest();
+
+	// The TurboR timer result doesn't depend on the interrupts: no sweep
+	uint32_t cnt = int_counter;
+	for (int32_t i=cnt+1310; !quiet && timingEngine != TIMING_TRTIMER && i>=cnt-1310; i+=-655) {		// ±0.02 interrupts in 0.01 steps
+		int_counter = i;
+		calculateMhz();
+		formatFixed(calculatedFreq, floatStr, 6);
+		cprintf("%s %lu: %s MHz\n", i==cnt?"->":"  ", INTS_x1E4(i), floatStr);
+	}
+
+	if (rtcCalibrated) {
+		int_counter = cnt;
+		calculateMhz();
+		uint32_t nominal = isNTSC ? NTSC_FPS : PAL_FPS;
+		formatFixed(calculatedFreq, floatStr, 6);
+		cprintf("RTC corrected: %s MHz\n", floatStr);
+		formatFixed(mulDiv(calculatedFreq, nominal, frameRate[isNTSC]), floatStr, 6);
+		cprintf("Nominal rate : %s MHz\n", floatStr);
+	}
+
+	if (timingEngine == TIMING_TRTIMER) {
+		int_counter = cnt;
+		calculateMhz();
+		formatFixed(calculatedFreq, floatStr, 6);
+		cprintf("TurboR timer: %s MHz\n", floatStr);
+		formatFixed(vblankFreq, floatStr, 6);
+		cprintf("VBLANK check: %s MHz\n", floatStr);
+	}
+
+	// Repeat the test to get the statistics (the last STATS_SAMPLES are kept)
+	if (!repeats) repeats = STATS_RUNS;
+	if (!quiet) cprintf("Repeating test x%u for statistics...\n", repeats);
+	int_counter = cnt;
+	calculateMhz();
+	statsReset();
+	statsAdd(calculatedFreq);
+	for (uint8_t i=1; i<repeats; i++) {
+		doInterruptLoop();
+		calculateCounterRest();
+		calculateMhz();
+		statsAdd(calculatedFreq);
+	}
+	statsCalculate(&stats);
+	formatStats(heap_top, false);
+	cprintf("%s MHz\n", heap_top);
+	formatFixed(stats.mean, floatStr, 6);
+	formatFixed(stats.ci95, heap_top, 6);
+	cprintf("Mean: %s \xf1%s MHz (95%% CI, %u outliers)\n", floatStr, heap_top, stats.total - stats.count);
+	historyAdd(mode, historyTurbo(), stats.median, historyFlags);
+
+	return roundedMhz(stats.mean);
+}
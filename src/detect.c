@@ -0,0 +1,284 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+
+	Overlay: platform detection at startup (see overlay.h)
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "globals.h"
+#include "msx_const.h"
+#include "dos.h"
+#include "conio.h"
+#include "utils.h"
+#include "ocm_ioports.h"
+#include "overlay.h"
+
+
+// ========================================================
+extern uint8_t msxVersionROM;
+extern uint8_t machineBrand;
+extern uint8_t cpuType;
+extern bool    isCMOS;
+extern uint8_t vdpType;
+extern bool    isNTSC;
+extern bool    turboPanaDetected;
+extern uint8_t turboRmode;
+extern bool    turboRdetected;
+extern bool    ocmDetected;
+extern bool    tidesDetected;
+extern bool    rtcDetected;
+extern uint16_t probeTicks[PROBE_COUNT];
+extern bool    detectCached;
+extern uint16_t machineFingerprint;
+
+uint8_t detectCPUtype();
+bool detectNTSC();
+
+
+// ========================================================
+//  Detection cache
+//
+//  The probes results are stored with a fingerprint of the BIOS ROM, and
+//  reused while it still matches. Hardware plugged later (e.g. a turbo
+//  cartridge) is not noticed: run 'dc' again to refresh the file.
+//  The CPU type and NMOS/CMOS depend on the current TurboR mode, so they are
+//  always probed.
+
+#define CACHE_MAGIC			"Z8C2"
+#define CACHE_ROMSTEP		0x100		// ROM sampled every 256 bytes...
+#define CACHE_ROMSAMPLES	128			// ...over the 32KB of the main ROM
+
+#define CACHE_NONE			0
+#define CACHE_STALE			1
+#define CACHE_VALID			2
+
+typedef struct {
+	char     magic[4];
+	uint8_t  msxVersion;
+	uint16_t romSum;
+	uint8_t  vdpType;
+	uint8_t  machineBrand;
+	bool     turboPana;
+	bool     turboR;
+	bool     ocm;
+	bool     tides;
+	bool     rtc;
+} DetectCache_t;
+
+static DetectCache_t cache;
+static uint16_t probeStart;			// JIFFY at the start of the probe
+static uint16_t probeFrameSpins;
+
+
+// ========================================================
+static uint8_t detectMachineBrand()
+{
+	if (ocmDetected) {
+		return BRAND_OCMPLD;
+	}
+	uint8_t result = 0;
+	uint8_t port40 = 255 - inportb(0x40);
+	for (uint8_t i=1; i<=26; i++) {
+		outportb(0x40, i);
+		if (inportb(0x40) == 255 - i) {
+			result = i;
+			break;
+		}
+	}
+	outportb(0x40, port40);
+	return result;
+}
+
+// Spins until JIFFY changes, and returns the spins done
+static uint16_t probeSpin() __naked __sdcccall(0)
+{
+	__asm
+		ld   hl, #0
+		ld   a, (JIFFY)
+		ld   b, a
+	.probeSpin:
+		inc  hl
+		ld   a, (JIFFY)
+		cp   b
+		jr   z, .probeSpin
+		ret
+	__endasm;
+}
+
+// The probes start at the beginning of a frame, and the fraction of the last
+// frame is measured spinning until the next one. A probe that starts in the
+// frame where the previous one ended needs no wait.
+static void probeBegin()
+{
+	if (!probeFrameSpins) {
+		probeSpin();
+		probeFrameSpins = probeSpin();		// Spins of a whole frame
+	} else if (varJIFFY != probeStart) {
+		probeSpin();
+	}
+	probeStart = varJIFFY;
+}
+
+static void probeEnd(uint8_t probe)
+{
+	uint16_t frames = varJIFFY - probeStart + 1;
+	uint16_t rest = probeSpin();
+
+	if (rest > probeFrameSpins) rest = probeFrameSpins;
+	probeTicks[probe] = (frames << 8) - (uint16_t)(((uint32_t)rest << 8) / probeFrameSpins);
+	probeStart = varJIFFY;
+}
+
+static uint16_t romFingerprint()
+{
+	uint16_t sum = 0;
+	uint16_t addr = CACHE_ROMSTEP / 2;
+
+	for (uint8_t i=0; i<CACHE_ROMSAMPLES; i++, addr+=CACHE_ROMSTEP) {
+		sum = ((sum << 1) | (sum >> 15)) + getRomByte(addr);
+	}
+	return sum;
+}
+
+static uint8_t loadCache(uint16_t romSum)
+{
+	if (!fopen(DETECT_CACHE)) {
+		return CACHE_NONE;
+	}
+	uint16_t size = fread((char*)&cache, sizeof(DetectCache_t));
+	fclose();
+	if (size != sizeof(DetectCache_t) || memcmp(cache.magic, CACHE_MAGIC, 4) ||
+		cache.msxVersion != msxVersionROM || cache.romSum != romSum)
+	{
+		return CACHE_STALE;
+	}
+	return CACHE_VALID;
+}
+
+static void saveCache(uint16_t romSum)
+{
+	memcpy(cache.magic, CACHE_MAGIC, 4);
+	cache.msxVersion = msxVersionROM;
+	cache.romSum = romSum;
+	cache.vdpType = vdpType;
+	cache.machineBrand = machineBrand;
+	cache.turboPana = turboPanaDetected;
+	cache.turboR = turboRdetected;
+	cache.ocm = ocmDetected;
+	cache.tides = tidesDetected;
+	cache.rtc = rtcDetected;
+	if (fcreate(DETECT_CACHE)) {
+		fwrite((char*)&cache, sizeof(DetectCache_t));
+		fclose();
+	}
+}
+
+static void probeAll()
+{
+	// VDP type
+	probeBegin();
+	vdpType = detectVDP();
+	probeEnd(PROBE_VDP);
+
+	// Check MSX2+ w/tPANA
+	probeBegin();
+	turboPanaDetected = detectTurboPana();
+	probeEnd(PROBE_TURBOPANA);
+
+	// Check TurboR
+	probeBegin();
+	turboRdetected = detectTurboR();
+	probeEnd(PROBE_TURBOR);
+
+	// Check OCM-PLD/MSX++
+	probeBegin();
+	ocmDetected = ocm_detectDevice(DEVID_OCMPLD);
+	probeEnd(PROBE_OCM);
+
+	// Check Tides-Rider
+	probeBegin();
+	tidesDetected = detectTidesRider();
+	probeEnd(PROBE_TIDES);
+
+	// Machine type
+	probeBegin();
+	machineBrand = detectMachineBrand();
+	probeEnd(PROBE_BRAND);
+
+	// Check RP5C01 RTC
+	probeBegin();
+	rtcDetected = detectRTC();
+	probeEnd(PROBE_RTC);
+}
+
+uint8_t overlayMain(char *arg)
+{
+	bool refresh = false;
+
+	// 'c' flag in the command line mode: probe again and save the cache
+	if (arg && arg[0] != '/') {
+		for (char *p = &arg[1]; *p; p++) {
+			if (*p == 'c' || *p == 'C') refresh = true;
+		}
+	}
+
+	// Check MSX2 ROM or higher
+	msxVersionROM = getRomByte(MSXVER);
+
+#ifndef _MSX1_
+	// This binary needs the 80 columns mode
+	if (!msxVersionROM) {
+		die("This program needs a MSX2 or higher: use Z80BENCH.COM\n");
+	}
+#endif
+
+	uint16_t romSum = romFingerprint();
+	machineFingerprint = romSum;
+	uint8_t cached = refresh ? CACHE_STALE : loadCache(romSum);
+
+	if (cached == CACHE_VALID) {
+		vdpType = cache.vdpType;
+		machineBrand = cache.machineBrand;
+		turboPanaDetected = cache.turboPana;
+		turboRdetected = cache.turboR;
+		ocmDetected = cache.ocm;
+		tidesDetected = cache.tides;
+		rtcDetected = cache.rtc;
+		detectCached = true;
+	} else {
+		probeAll();
+		if (cached == CACHE_STALE) {
+			saveCache(romSum);
+		}
+	}
+
+	// Check CPU type
+	probeBegin();
+	cpuType = detectCPUtype();
+	probeEnd(PROBE_CPU);
+
+	// Detect if Z80 is NMOS/CMOS
+	probeBegin();
+	isCMOS = detectNMOS();
+	probeEnd(PROBE_NMOS);
+
+	// For MSX1 with V9938 or higher
+	if (!msxVersionROM && vdpType >= VDP_V9938) {
+		varRG9SAV.raw = 0;
+		varRG9SAV.NT = !(getRomByte(LOCALE) >> 7);
+		setNTSC(varRG9SAV.NT);
+	}
+
+	// Current TurboR mode
+	if (turboRdetected) {
+		turboRmode = getCpuTurboR();
+	}
+
+	// NTSC/PAL
+	isNTSC = detectNTSC();
+	return 0;
+}
@@ -0,0 +1,91 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "globals.h"
+#include "dos.h"
+#include "utils.h"
+#include "ocm_ioports.h"
+#include "history.h"
+
+
+extern uint16_t machineFingerprint;
+extern uint8_t  msxVersionROM;
+extern uint8_t  machineBrand;
+extern bool     isNTSC;
+extern bool     turboPanaDetected;
+extern uint8_t  turboRmode;
+extern bool     turboRdetected;
+extern bool     ocmDetected;
+extern bool     tidesDetected;
+extern uint8_t  kernelIdx;
+extern uint8_t  timingEngine;
+extern uint8_t  loopCount;
+extern uint32_t int_counter;
+extern uint16_t counterRestHL;
+
+static History_t record;
+
+
+// ========================================================
+// Index of ocmSmartCmd[] read back from the OCM system info ports
+uint8_t ocmSpeedIndex()
+{
+	OCM_P47_SysInfo0_t info0;
+	OCM_P48_SysInfo1_t info1;
+
+	info0.raw = ocm_readPort(OCM_SYSINFO0_PORT);
+	info1.raw = ocm_readPort(OCM_SYSINFO1_PORT);
+	if (info1.turboPana) return 1;
+	return info0.cpuCustomSpeed ? info0.cpuCustomSpeed + 1 : 0;
+}
+
+// Current turbo mode of the first turbo device found
+uint8_t historyTurbo()
+{
+	if (turboRdetected) return TURBO_CODE(TURBO_TR, turboRmode);
+	if (ocmDetected) return TURBO_CODE(TURBO_OCM, ocmSpeedIndex());
+	if (tidesDetected) return TURBO_CODE(TURBO_TIDES, getTidesSpeed() & 3);
+	if (turboPanaDetected) return TURBO_CODE(TURBO_PANA, getTurboPana());
+	return TURBO_NONE;
+}
+
+void historyAdd(char mode, uint8_t turbo, uint32_t freq, uint8_t flags)
+{
+	SYSTEMDATE_t date;
+	SYSTEMTIME_t time;
+
+	getSystemDate(&date);
+	getSystemTime(&time);
+
+	record.version = HISTORY_VERSION;
+	record.romSum = machineFingerprint;
+	record.msxVersion = msxVersionROM;
+	record.brand = machineBrand;
+	record.year = date.year;
+	record.month = date.month;
+	record.day = date.day;
+	record.hours = time.hours;
+	record.minutes = time.minutes;
+	record.mode = mode;
+	record.flags = flags | (isNTSC ? HIST_NTSC : 0);
+	record.kernel = kernelIdx;
+	record.timing = timingEngine;
+	record.loops = loopCount;
+	record.turbo = turbo;
+	record.ints = int_counter;
+	record.rest = counterRestHL;
+	record.freq = freq;
+
+	if (fopen(HISTORY_FILE)) {
+		fseek(0, SEEK_END);
+	} else if (!fcreate(HISTORY_FILE)) {
+		return;
+	}
+	fwrite((char*)&record, sizeof(History_t));
+	fclose();
+}
@@ -0,0 +1,217 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "kernels.h"
+
+
+// T-states in a standard MSX Z80 of the unrolled shift-and-add multiplies
+// used as the reference for the R800 MULUB/MULUW instructions, in the worst
+// case (every multiplier bit set, and a carry in every 16 bits add):
+//
+//   MUL8: HL = A*E                     MUL16: DE:HL = DE*BC
+//     ld   h, a         ; 5              ld   hl, #0        ; 11
+//     ld   l, #0        ; 8            16 times:
+//     ld   d, l         ; 5              add  hl, hl        ; 12
+//   8 times:                             rl   e             ; 10
+//     add  hl, hl       ; 12             rl   d             ; 10
+//     jr   nc, .+3      ; 8/13           jr   nc, .+6       ; 8/13
+//     add  hl, de       ; 12             add  hl, bc        ; 12
+//                                        jr   nc, .+3       ; 8/13
+//                                        inc  de            ; 7
+#define Z80_MUL8_CYCLES		(18 + 8*32)
+#define Z80_MUL16_CYCLES	(11 + 16*67)
+
+// kernelMul() with each MULUB/MULUW replaced by the Z80 routines
+#define Z80_MUL_BLOCK		(18 + 16*(31 + 5*Z80_MUL8_CYCLES + 2*Z80_MUL16_CYCLES) + 11)
+
+uint8_t kernelBuffer[256];
+
+void kernelALU();
+void kernelMemory();
+void kernelBlockMove();
+void kernelStack();
+void kernelIndexed();
+void kernelIO();
+void kernelMul();
+
+const Kernel_t kernels[KERNEL_COUNT] = {
+	{ "DEC HL loop", NULL,            0,                                  0,    0 },
+	{ "ALU reg",     kernelALU,       3278,                               450,  0 },
+	{ "Load/Store",  kernelMemory,    4249,                               349,  0 },
+	{ "LDIR/LDI",    kernelBlockMove, 2685,                               547,  0 },
+	{ "PUSH/POP",    kernelStack,     4462,                               333,  0 },
+	{ "IX/IY index", kernelIndexed,   5998,                               249,  0 },
+	{ "I/O ports",   kernelIO,        3798,                               390,  0 },
+	{ "R800 MUL",    kernelMul,       Z80_MUL_BLOCK,                      1200, KFLAG_R800_ONLY },
+};
+
+
+// ========================================================
+bool kernelIsAvailable(uint8_t idx, bool isR800)
+{
+	return !(kernels[idx].flags & KFLAG_R800_ONLY) || isR800;
+}
+
+uint32_t kernelLoopCycles(uint8_t idx)
+{
+	const Kernel_t *k = &kernels[idx];
+	return (uint32_t)k->blocks * (k->blockCycles + HARNESS_BLOCK_CYCLES) + HARNESS_LOOP_CYCLES;
+}
+
+
+// ========================================================
+// T-states in comments include the MSX M1 wait state.
+
+void kernelALU() __naked
+{
+	__asm
+		ld   b, #32					; 8
+	.kALU:
+		add  a, c					; 5
+		sub  d						; 5
+		and  e						; 5
+		or   h						; 5
+		xor  l						; 5
+		cp   c						; 5
+		inc  d						; 5
+		dec  e						; 5
+		add  a, #3					; 8
+		adc  a, h					; 5
+		sbc  a, l					; 5
+		rlca						; 5
+		rrca						; 5
+		inc  c						; 5
+		dec  h						; 5
+		neg							; 10
+		djnz .kALU					; 14/9
+		ret							; 11
+	__endasm;
+}
+
+void kernelMemory() __naked
+{
+	__asm
+		ld   hl, #_kernelBuffer		; 11
+		ld   b, #32					; 8
+	.kMemory:
+		ld   a, (hl)				; 8
+		ld   (hl), a				; 8
+		inc  hl						; 7
+		ld   e, (hl)				; 8
+		ld   (hl), e				; 8
+		inc  hl						; 7
+		ld   a, (#_kernelBuffer+64)	; 14
+		ld   (#_kernelBuffer+65), a	; 14
+		ld   de, (#_kernelBuffer+66)	; 22
+		ld   (#_kernelBuffer+68), de	; 22
+		djnz .kMemory				; 14/9
+		ret							; 11
+	__endasm;
+}
+
+void kernelBlockMove() __naked
+{
+	__asm
+		ld   hl, #_kernelBuffer		; 11
+		ld   de, #_kernelBuffer+128	; 11
+		ld   bc, #64				; 11
+		ldir						; 63*23 + 18
+		ld   hl, #_kernelBuffer		; 11
+		ld   de, #_kernelBuffer+128	; 11
+		.rept 64
+		ldi							; 64*18
+		.endm
+		ret							; 11
+	__endasm;
+}
+
+void kernelStack() __naked
+{
+	__asm
+		ld   b, #32					; 8
+	.kStack:
+		push bc						; 12
+		push de						; 12
+		push hl						; 12
+		push af						; 12
+		pop  af						; 11
+		pop  hl						; 11
+		pop  de						; 11
+		pop  bc						; 11
+		push ix						; 17
+		pop  iy						; 16
+		djnz .kStack				; 14/9
+		ret							; 11
+	__endasm;
+}
+
+void kernelIndexed() __naked
+{
+	__asm
+		ld   ix, #_kernelBuffer		; 16
+		ld   iy, #_kernelBuffer+64	; 16
+		ld   b, #32					; 8
+	.kIndexed:
+		ld   a, 0(ix)				; 21
+		ld   0(iy), a				; 21
+		ld   a, 1(ix)				; 21
+		add  a, 1(iy)				; 21
+		ld   2(ix), a				; 21
+		ld   e, 3(iy)				; 21
+		ld   3(ix), e				; 21
+		inc  4(iy)					; 25
+		djnz .kIndexed				; 14/9
+		ret							; 11
+	__endasm;
+}
+
+void kernelIO() __naked
+{
+	// PSG ports are used: 0xA0 (address latch, write) and 0xA2 (data, read).
+	// Only the address latch is written, so no PSG register is modified.
+	__asm
+		ld   c, #0xa2				; 8
+		ld   b, #32					; 8
+	.kIO:
+		in   a, (0xa2)				; 12
+		out  (0xa0), a				; 12
+		in   e, (c)					; 14
+		in   d, (c)					; 14
+		in   a, (0xa2)				; 12
+		out  (0xa0), a				; 12
+		in   l, (c)					; 14
+		in   h, (c)					; 14
+		djnz .kIO					; 14/9
+		ret							; 11
+	__endasm;
+}
+
+void kernelMul() __naked
+{
+	// R800 only: the loop counter is kept in B' because MULUW uses BC/DE/HL
+	__asm
+		exx							; 5
+		ld   b, #16					; 8
+		exx							; 5
+	.kMul:
+		ld   a, l					; 5
+		.db  0xed, 0xc9			; MULUB A,C
+		.db  0xed, 0xd1			; MULUB A,D
+		.db  0xed, 0xd9			; MULUB A,E
+		.db  0xed, 0xc3			; MULUW HL,BC
+		.db  0xed, 0xc9			; MULUB A,C
+		.db  0xed, 0xd1			; MULUB A,D
+		.db  0xed, 0xc3			; MULUW HL,BC
+		exx							; 5
+		dec  b						; 5
+		exx							; 5
+		jp   nz, .kMul				; 11
+		ret							; 11
+	__endasm;
+}
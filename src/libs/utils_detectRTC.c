@@ -0,0 +1,12 @@
+#include "utils.h"
+#include "conio.h"
+#include "msx_const.h"
+
+
+// RP5C01 registers are 4 bits wide, and read as 0xFF when there is no RTC
+bool detectRTC()
+{
+	uint8_t tens = getRegisterRTC(RTC_SECONDS_TENS, 0) & 0x0f;
+	uint8_t units = getRegisterRTC(RTC_SECONDS_UNITS, 0) & 0x0f;
+	return tens <= 5 && units <= 9;
+}
@@ -0,0 +1,35 @@
+#include "utils.h"
+#include "msx_const.h"
+
+
+// Prints a string with the MSX-DOS _CONOUT function, so the output can be
+// redirected to a file (e.g. "z80bench /csv >> results.csv" in MSX-DOS 2).
+// The '\n' characters are printed as CR+LF.
+void dosPuts(const char *str) __naked __sdcccall(1)
+{
+	str;
+	__asm
+		push ix
+	dps_loop:
+		ld   a, (hl)
+		or   a
+		jr   z, dps_end
+		inc  hl
+		push hl
+		cp   #10
+		jr   nz, dps_char
+		ld   e, #13
+		ld   c, #0x02				; _CONOUT
+		DOSCALL
+		ld   a, #10
+	dps_char:
+		ld   e, a
+		ld   c, #0x02				; _CONOUT
+		DOSCALL
+		pop  hl
+		jr   dps_loop
+	dps_end:
+		pop  ix
+		ret
+	__endasm;
+}
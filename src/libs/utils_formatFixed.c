@@ -0,0 +1,27 @@
+#include "utils.h"
+
+
+static const uint32_t powers10[] = {
+	1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+	10000UL, 1000UL, 100UL, 10UL, 1UL
+};
+
+// Prints value/10^decimals using only subtractions (at most 9 by digit)
+char *formatFixed(uint32_t value, char *txt, uint8_t decimals)
+{
+	uint32_t power;
+	char digit, *p = txt;
+	uint8_t units = 9 - decimals;
+
+	for (uint8_t i=0; i<10; i++) {
+		power = powers10[i];
+		for (digit='0'; value >= power; digit++) {
+			value -= power;
+		}
+		if (decimals && i == units+1) *p++ = '.';
+		if (p != txt || digit != '0' || i >= units) *p++ = digit;
+	}
+	*p = '\0';
+
+	return p;
+}
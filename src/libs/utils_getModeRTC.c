@@ -0,0 +1,14 @@
+#include "utils.h"
+#include "conio.h"
+#include "msx_const.h"
+
+
+// Mode register: block (bits 0-1), alarm enable (bit 2) & timer enable (bit 3)
+uint8_t getModeRTC()
+{
+	ASM_DI;
+	outportb(0xb4, RTC_MODE);
+	uint8_t result = inportb(0xb5) & 0x0f;
+	ASM_EI;
+	return result;
+}
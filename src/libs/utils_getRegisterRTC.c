@@ -3,11 +3,12 @@
 #include "msx_const.h"
 
 
+// The timer & alarm enable bits of the mode register are kept
 uint8_t getRegisterRTC(uint8_t reg, uint8_t block)
 {
 	ASM_DI;
-	outportb(0xb4, 13);
-	outportb(0xb5, block);
+	outportb(0xb4, RTC_MODE);
+	outportb(0xb5, (inportb(0xb5) & RTC_MODE_ENABLES) | block);
 	outportb(0xb4, reg);
 	uint8_t result = inportb(0xb5);
 	ASM_EI;
@@ -0,0 +1,35 @@
+#include "utils.h"
+
+
+// a*b/c with a 64 bits intermediate product using only 32 bits operations.
+// The result must fit in 32 bits (the high half of a*b must be less than c).
+uint32_t mulDiv(uint32_t a, uint32_t b, uint32_t c)
+{
+	uint16_t al = a, ah = a >> 16;
+	uint16_t bl = b, bh = b >> 16;
+	uint32_t lo = (uint32_t)al * bl;
+	uint32_t hi = (uint32_t)ah * bh;
+	uint32_t mid = (uint32_t)al * bh;
+	uint32_t tmp = (uint32_t)ah * bl;
+	bool carry;
+
+	// Product: hi:lo = hi<<32 + mid<<16 + lo
+	mid += tmp;
+	if (mid < tmp) hi += 0x10000UL;
+	hi += mid >> 16;
+	tmp = mid << 16;
+	lo += tmp;
+	if (lo < tmp) hi++;
+
+	// Restoring division: the quotient bits enter by the right of lo
+	for (uint8_t i=0; i<32; i++) {
+		carry = (hi & 0x80000000UL) != 0;
+		hi = (hi << 1) | (lo >> 31);
+		lo <<= 1;
+		if (carry || hi >= c) {
+			hi -= c;
+			lo |= 1;
+		}
+	}
+	return lo;
+}
@@ -0,0 +1,26 @@
+#include <stdint.h>
+#include "utils.h"
+#include "msx_const.h"
+
+
+// Reads a byte of any slot (slot ID format F000SSPP)
+uint8_t readSlot(uint8_t slot, uint16_t address) __naked __sdcccall(0)
+{
+	slot, address;
+	__asm
+		ld   hl, #2
+		add  hl, sp
+		ld   a, (hl)		; A = slot
+		inc  hl
+		ld   e, (hl)
+		inc  hl
+		ld   d, (hl)
+		ex   de, hl			; HL = address
+		push ix
+		call RDSLT
+		pop  ix
+		ld   l, a			; Returns L = byte content
+		ei
+		ret
+	__endasm;
+}
@@ -0,0 +1,24 @@
+#include <string.h>
+#include "utils.h"
+
+
+// Unpacks data from bin/panelimage.c:
+//   0x00       end of data
+//   0x01-0x7f  n literal bytes follow
+//   0x80-0xff  next byte repeated n-0x7e times
+uint8_t *rleUnpack(const uint8_t *src, uint8_t *dst)
+{
+	uint8_t n;
+
+	while ((n = *src++)) {
+		if (n & 0x80) {
+			n -= 0x7e;
+			memset(dst, *src++, n);
+		} else {
+			memcpy(dst, src, n);
+			src += n;
+		}
+		dst += n;
+	}
+	return dst;
+}
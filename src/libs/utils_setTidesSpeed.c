@@ -33,6 +33,20 @@ void setTidesSpeed(uint8_t speed) __naked __z88dk_fastcall
 	__endasm;
 }
 
+// ========================================================
+uint8_t getTidesSpeed() __naked __sdcccall(1)
+{
+	__asm
+		di
+		call selectRegister14block2
+		in	 a, (c)
+		ei
+
+		and  #0b00000111		; Return A = speed [0-3] | TIDES_SLOTS357
+		ret
+	__endasm;
+}
+
 // ========================================================
 bool detectTidesRider() __naked __sdcccall(1)
 {
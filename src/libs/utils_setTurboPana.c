@@ -40,4 +40,26 @@ bool setTurboPana(bool enabled) __naked __sdcccall(1)
 		out  (0x40),a
 		ret
 	__endasm;
-}
\ No newline at end of file
+}
+
+bool getTurboPana() __naked __sdcccall(1)
+{
+	__asm
+		in   a,(0x40)		; back up the value of I/O port 40h
+		cpl
+		push af
+
+		ld   a,#8
+		out  (0x40),a		; out the manufacturer code 8 (Panasonic) to I/O port 40h
+
+		in   a,(0x41)
+		cpl
+		and  #1				; bit 0 reset: turbo enabled
+		ld   l,a
+
+		pop  af				; restore the value of I/O port 40h
+		out  (0x40),a
+		ld   a,l			; return A = enabled
+		ret
+	__endasm;
+}
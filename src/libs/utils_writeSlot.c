@@ -0,0 +1,28 @@
+#include <stdint.h>
+#include "utils.h"
+#include "msx_const.h"
+
+
+// Writes a byte to any slot (slot ID format F000SSPP)
+void writeSlot(uint8_t slot, uint16_t address, uint8_t value) __naked __sdcccall(0)
+{
+	slot, address, value;
+	__asm
+		ld   hl, #2
+		add  hl, sp
+		ld   a, (hl)		; A = slot
+		inc  hl
+		ld   e, (hl)
+		inc  hl
+		ld   d, (hl)
+		inc  hl
+		ld   c, (hl)		; C = value
+		ex   de, hl			; HL = address
+		ld   e, c			; E = value
+		push ix
+		call WRSLT
+		pop  ix
+		ei
+		ret
+	__endasm;
+}
@@ -0,0 +1,91 @@
+	;--- z80bench.com stub loader
+	;    Loads Z80BMSX1.COM (MSX1) or Z80BMSX2.COM (MSX2 or higher) at 0x100
+	;    and runs it. The command line at 0x80 is kept untouched, so the
+	;    loaded program sees the same parameters.
+	;
+	;    The loader copies itself to 0xC000 (like crt0 does with its command
+	;    line parser) because the program is read over the stub memory.
+
+	BDOS	= 0x0005
+	RDSLT	= 0x000c
+	MSXVER	= 0x002d
+	EXPTBL	= 0xfcc1
+	RELOC	= 0xc000
+
+	_TERM0	= 0x00			;DOS functions
+	_STROUT	= 0x09
+	_FOPEN	= 0x0f
+	_SETDTA	= 0x1a
+	_RDBLK	= 0x27
+
+	.area _HEADER (ABS)
+
+	.org    0x0100			;MSX-DOS .COM programs start address
+
+	;--- Select the binary using the MSX version of the BIOS ROM
+
+init:
+	ld      a,(EXPTBL)
+	ld      hl,#MSXVER
+	call    RDSLT
+	ei
+	or      a
+	jr      z,msx1
+	ld      a,#0x32			;'2'
+	ld      (fcbName+7),a
+	ld      (errorMsg+7),a
+msx1:
+
+	;--- Copy the loader to 0xC000 and run it
+
+	ld      hl,#loader
+	ld      de,#RELOC
+	ld      bc,#loaderEnd-loader
+	ldir
+	jp      RELOC
+
+	;>>> Loader begin (runs at RELOC, so absolute addresses are relocated)
+
+loader:
+	ld      de,#fcb-loader+RELOC
+	ld      c,#_FOPEN
+	call    BDOS
+	or      a
+	jr      nz,notFound
+
+	ld      hl,#1
+	ld      (fcb+14-loader+RELOC),hl	;Record size = 1 byte
+	dec     hl
+	ld      (fcb+33-loader+RELOC),hl	;Random record = 0
+	ld      (fcb+35-loader+RELOC),hl
+
+	ld      de,#0x0100
+	ld      c,#_SETDTA
+	call    BDOS
+
+	ld      de,#fcb-loader+RELOC
+	ld      hl,#RELOC-0x0100			;Maximum program size
+	ld      c,#_RDBLK
+	call    BDOS
+	jp      0x0100
+
+notFound:
+	ld      de,#errorMsg-loader+RELOC
+	ld      c,#_STROUT
+	call    BDOS
+	ld      c,#_TERM0
+	jp      BDOS
+
+errorMsg:
+	.ascii  "Z80BMSX1.COM not found"
+	.db     13,10,0x24
+
+fcb:
+	.db     0					;Default drive
+fcbName:
+	.ascii  "Z80BMSX1COM"
+	.ds     25
+
+loaderEnd:
+
+	;>>> Loader end
@@ -0,0 +1,242 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "msx_const.h"
+#include "dos.h"
+#include "memprof.h"
+
+
+uint16_t memprofBlocks[MEMPROF_TESTS];
+uint8_t  memprofCode[8];				// Resident copy of an execution loop
+
+static uint8_t saved[MEMPROF_SIZE];
+
+
+// ========================================================
+// Runs a test block until MEMPROF_FRAMES frames have passed, and stores the
+// blocks done in memprofBlocks[test]. The interrupts must be disabled.
+// T-states in comments include the MSX M1 wait state.
+static void runTest(uint8_t test) __naked __sdcccall(1)
+{
+	test;
+	__asm
+		ld   l, a
+		ld   h, #0
+		add  hl, hl
+		push hl
+		ld   de, #.mpTests
+		add  hl, de
+		ld   a, (hl)
+		inc  hl
+		ld   h, (hl)
+		ld   l, a
+		ld   (#.mpCall+1), hl		; Patch the call to the test block
+		ld   c, #MEMPROF_FRAMES
+		ld   de, #0
+		in   a, (0x99)				; Clear the VBLANK flag
+	.mpSync:
+		in   a, (0x99)				; Wait for the start of a frame
+		and  a
+		jp   p, .mpSync
+	.mpLoop:
+	.mpCall:
+		call 0						; 18
+		inc  de						; 7
+		in   a, (0x99)				; 12
+		and  a						; 5
+		jp   p, .mpLoop				; 11
+		dec  c
+		jp   nz, .mpLoop
+		pop  hl
+		ld   bc, #_memprofBlocks
+		add  hl, bc
+		ld   (hl), e
+		inc  hl
+		ld   (hl), d
+		ret
+
+	.mpTests:
+		.dw  .mpRead, .mpWrite, .mpLdir
+
+	.mpRead:
+		ld   hl, #MEMPROF_ADDR		; 11
+		ld   b, #0					; 8
+	.mpRead1:
+		ld   a, (hl)				; 8
+		inc  l						; 5
+		djnz .mpRead1				; 14/9
+		ret							; 11
+
+	.mpWrite:
+		ld   hl, #MEMPROF_ADDR		; 11
+		ld   b, #0					; 8
+	.mpWrite1:
+		ld   (hl), a				; 8
+		inc  l						; 5
+		djnz .mpWrite1				; 14/9
+		ret							; 11
+
+	.mpLdir:
+		ld   hl, #MEMPROF_ADDR		; 11
+		ld   de, #MEMPROF_ADDR+MEMPROF_BLOCK_BYTES	; 11
+		ld   bc, #MEMPROF_BLOCK_BYTES	; 11
+		ldir						; 23/18
+		ret							; 11
+	__endasm;
+}
+
+static void enableSlot(uint8_t slot) __naked __sdcccall(1)
+{
+	slot;
+	__asm
+		push ix
+		ld   h, #0x80				; Page 2
+		call ENASLT
+		pop  ix
+		ret
+	__endasm;
+}
+
+static bool isRAM()
+{
+	volatile uint8_t *first = (uint8_t*)MEMPROF_ADDR;
+	volatile uint8_t *last = (uint8_t*)(MEMPROF_ADDR + MEMPROF_SIZE - 1);
+	uint8_t value1 = *first, value2 = *last;
+	bool ram;
+
+	*first = ~value1;
+	*last = ~value2;
+	ram = *first == (uint8_t)~value1 && *last == (uint8_t)~value2;
+	*first = value1;
+	*last = value2;
+	return ram;
+}
+
+static void runTests()
+{
+	memcpy(saved, (void*)MEMPROF_ADDR, MEMPROF_SIZE);
+	for (uint8_t i=0; i<MEMPROF_TESTS; i++) {
+		runTest(i);
+	}
+	memcpy((void*)MEMPROF_ADDR, saved, MEMPROF_SIZE);
+}
+
+
+// ========================================================
+// Profiles the page 2 of a slot, if it has RAM
+bool memprofSlot(uint8_t slot)
+{
+	bool ram;
+
+	ASM_DI;
+	enableSlot(slot);
+	ram = isRAM();
+	if (ram) runTests();
+	enableSlot(varRAMAD2);
+	ASM_EI;
+	return ram;
+}
+
+// Profiles a mapper segment, also from other mapper slots
+void memprofSegment(MAPPER_Segment *segment)
+{
+	MAPPER_Segment seg = *segment;		// The caller's copy may be in page 2
+
+	ASM_DI;
+	enableSlot(seg.slotAddress);
+	mapperSetSegment(MEMPROF_PAGE, &seg);
+	runTests();
+	mapperSetOriginalSegmentBack(MEMPROF_PAGE);
+	enableSlot(varRAMAD2);
+	ASM_EI;
+}
+
+// Counts the calls done in MEMPROF_FRAMES frames. CALSLT may enable the
+// interrupts, so a frame is also counted when JIFFY changes.
+uint16_t memprofCalls(uint8_t slot, uint16_t address, uint16_t count) __naked __sdcccall(0)
+{
+	slot, address, count;
+	__asm
+		push ix
+		ld   ix, #4
+		add  ix, sp
+		ld   a, 0(ix)
+		ld   (#.mcSlot), a
+		ld   l, 1(ix)
+		ld   h, 2(ix)
+		ld   (#.mcAddress), hl
+		ld   l, 3(ix)
+		ld   h, 4(ix)
+		ld   (#.mcCount), hl
+		ld   hl, #0
+		ld   (#.mcCalls), hl
+		ld   a, #MEMPROF_FRAMES
+		ld   (#.mcFrames), a
+		di
+		in   a, (0x99)				; Clear the VBLANK flag
+	.mcSync:
+		in   a, (0x99)				; Wait for the start of a frame
+		and  a
+		jp   p, .mcSync
+		ld   a, (#JIFFY)
+		ld   (#.mcJiffy), a
+	.mcLoop:
+		ld   bc, (#.mcCount)
+		ld   a, (#.mcSlot)
+		cp   #MEMPROF_LOCAL
+		jr   z, .mcLocal
+		ld   h, a
+		ld   l, #0
+		push hl
+		pop  iy
+		ld   ix, (#.mcAddress)
+		call CALSLT
+		jr   .mcDone
+	.mcLocal:
+		ld   hl, (#.mcAddress)
+		call .mcJump
+	.mcDone:
+		di
+		ld   hl, (#.mcCalls)
+		inc  hl
+		ld   (#.mcCalls), hl
+		in   a, (0x99)
+		and  a
+		jp   m, .mcFrame
+		ld   a, (#JIFFY)
+		ld   hl, #.mcJiffy
+		cp   (hl)
+		jp   z, .mcLoop
+	.mcFrame:
+		ld   a, (#JIFFY)
+		ld   (#.mcJiffy), a
+		ld   hl, #.mcFrames
+		dec  (hl)
+		jp   nz, .mcLoop
+		ei
+		ld   hl, (#.mcCalls)
+		pop  ix
+		ret
+	.mcJump:
+		jp   (hl)
+
+	.mcSlot:
+		.db  0
+	.mcFrames:
+		.db  0
+	.mcJiffy:
+		.db  0
+	.mcAddress:
+		.dw  0
+	.mcCount:
+		.dw  0
+	.mcCalls:
+		.dw  0
+	__endasm;
+}
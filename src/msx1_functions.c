@@ -1,16 +1,23 @@
 #include <string.h>
 #include "globals.h"
+#include "panelstr.h"
 #include "msx1_functions.h"
 #include "msx_const.h"
 #include "heap.h"
 #include "conio.h"
 #include "utils.h"
 #include "conio_aux.h"
+#include "kernels.h"
+#include "speedglyphs.h"
+#include "panel40.h"
+#include "screen.h"
 
 
 // ========================================================
 extern uint32_t int_counter;
-extern float   calculatedFreq;
+extern uint32_t calculatedFreq;
+extern uint16_t speedCentiMhz;
+extern uint16_t speedPercent;
 extern uint8_t speedLineScale;
 extern char   *floatStr;
 extern uint8_t msxVersionROM;
@@ -19,33 +26,24 @@ extern uint8_t cpuType;
 extern bool    isCMOS;
 extern uint8_t vdpType;
 extern bool    isNTSC;
-extern const char titleStr[];
-extern const char authorStr[];
-extern const char infoMachineStr[];
-extern const char infoCpuTypeStr[];
-extern const char infoVdpTypeStr[];
+extern uint8_t kernelIdx;
+extern uint8_t loopCount;
+extern bool    adaptiveLoop;
+extern uint8_t timingEngine;
 extern const char *machineTypeStr[];
 extern const char *machineBrandStr[];
 extern const char *cpuTypesStr[];
 extern const char *cmosStr[];
 extern const char *vdpTypeStr[];
 extern const char *vdpModesStr[];
-extern const char *info1Str;
-extern const char *info2Str;
 
-static const char *axisXLabelsStr[] = {
-	"  5", " 10", " 15", " 20", " 25", "30"
-};
-static const char *axisYLabelsStr[] = {
-	"", "CPU speed", "", "", "MSX std", "", "", "turboPANA", ""
-};
-static const char *speedLineStr = "    \x92    \x92    \x92    \x92    \x92    \x92";
-static const float speedDecLimits[] = { .14f, .29f, .43f, .57f, .71f, .86f, 1.f };
+static const char *speedLineStr = PANEL_SPEEDLINE40_STR;
 
 
 // ========================================================
 void waitVBLANK();
 void putstrxy(uint8_t x, uint8_t y, const char *str);
+char *formatStats(char *str, bool compact);
 
 
 // ========================================================
@@ -61,34 +59,42 @@ void msx1_showVDPtype()
 	putstrxy(15,6, heap_top);
 }
 
+void msx1_showKernel()
+{
+	csprintf(heap_top, "[F5] Test: %s   ", kernels[kernelIdx].name);
+	putstrxy(3,22, heap_top);
+}
+
+void msx1_showLoopMode()
+{
+	csprintf(heap_top, "[F7] x%u %s  ", loopCount, adaptiveLoop ? "auto" : "fixed");
+	putstrxy(3,23, heap_top);
+	if (vdpType) {								// V9938 or higher
+		putstrxy(29,22, timingEngine ? "[F8] Lines " : "[F8] VBLANK");
+	}
+}
+
 // ========================================================
 #define GR_X	10
 #define GR_Y	8
 #define GR_H	9
-#define LABELSY_X 	1
-#define LABELSY_Y 	GR_Y
 
-static uint16_t formatSpeedLine(char *floatStr, float speed)
+static uint16_t formatSpeedLine(char *floatStr, uint16_t speed)
 {
-	uint16_t speedUnits = (uint16_t)(speed / speedLineScale);
-	float speedDecimal = speed / speedLineScale - speedUnits;
+	uint16_t cell = 100 * speedLineScale;			// 1 MHz by cell (MHz x100)
+	uint16_t speedUnits = speed / cell;
 	char *q = heap_top, *p;
 
 	// Prepare line buffer
 	memcpy(q, speedLineStr, 30);
 	memset(q, '\x8e', speedUnits);
 	q += speedUnits;
-	for (uint8_t i=0; i<sizeof(speedDecLimits); i++) {
-		if (speedDecimal <= speedDecLimits[i]) {
-			*q = '\x88'+i;
-			break;
-		}
-	}
+	*q = speedGlyph[(speed - speedUnits * cell) / (2 * speedLineScale)];
 	*++q = ' ';
 	q++;
 
 	// Print speed numbers
-	p = formatFloat(speed, floatStr, 2);
+	p = formatFixed(speed, floatStr, 2);
 	memcpy(q, floatStr, p-floatStr);
 
 	return q-heap_top + p-floatStr;
@@ -96,26 +102,12 @@ static uint16_t formatSpeedLine(char *floatStr, float speed)
 
 void msx1_drawPanel()
 {
-	uint8_t i;
+	screenInvalidate();
 
+	// Static panel prebuilt by bin/panelimage.c
+	rleUnpack(panel40Names, heap_top);
 	waitVBLANK();
-
-	// Big frame
-	_fillVRAM(0, 40, '\x80');
-	_fillVRAM(23*40, 40, '\x80');
-
-	// Title
-	putstrxy(2, 1, titleStr);
-
-	// Author
-	putlinexy(27, 24, 13, authorStr);
-
-	// Info
-	drawFrame(1,2, 40,7);
-	putstrxy(3,3, infoMachineStr);
-	putstrxy(3,4, infoCpuTypeStr);
-	putstrxy(3,5, "CPU Speed : --         ---%");
-	putstrxy(3,6, infoVdpTypeStr);
+	_copyRAMtoVRAM((uint16_t)heap_top, 0x0000, PANEL40_NAMES_SIZE);
 
 	// Machine type
 	if (machineBrand == 0) {
@@ -131,64 +123,47 @@ void msx1_drawPanel()
 	// Video mode
 	msx1_showVDPtype();
 
-	// Graph
-	cvlinexy(GR_X,GR_Y, GR_H);
-	putlinexy(GR_X,GR_Y+GR_H, 1, "\x1a");
-
-	// Labels X
-	for (i=1; i<7; i++) {
-		putlinexy(GR_X+i*5-4,GR_Y+GR_H, 5, "\x91\x91\x91\x91\x8f");
-		putstrxy(GR_X-1+i*5,GR_Y+GR_H+1, axisXLabelsStr[i-1]);
-	}
-
-	// Labels Y
-	for (i=0; i<9; i++) {
-		putlinexy(GR_X+1, LABELSY_Y+i, 30, speedLineStr);
-		putstrxy(LABELSY_X, LABELSY_Y+i, axisYLabelsStr[i]);
-	}
-
 	// Draw fixed graphs
-	// Draw fixed graphs
-	formatSpeedLine(floatStr, MSX_CLOCK);		// 3.57 MHz
+	formatSpeedLine(floatStr, MSX_CLOCK/10000);		// 3.57 MHz
 	putlinexy(GR_X+1, GR_Y+4, 30, heap_top);
-	formatSpeedLine(floatStr, MSX_CLOCK*1.5f);	// 5.36 MHz
+	formatSpeedLine(floatStr, MSX_CLOCK*3/20000);	// 5.36 MHz
 	putlinexy(GR_X+1, GR_Y+7, 30, heap_top);
 
 	// Information
-	putstrxy(3,20, info1Str);
-	putstrxy(3,21, info2Str);
-	putstrxy(23, 23, "Hold [ESC] to exit");
+	msx1_showKernel();
+	msx1_showLoopMode();
 }
 
 void msx1_drawCpuSpeed()
 {
 	char *p;
 
-	// Draw counter in top-right border
-	gotoxy(3,24);
-	cprintf("\x86 %lu \x87\x80\x80", int_counter);
+	// Draw counter in bottom border
+	csprintf(heap_top, "\x86 %lu \x87\x80\x80", INTS_x1E4(int_counter));
+	screenUpdate(SCR_COUNTER, 3, 24, strlen(heap_top), heap_top);
 
 	// Draw % of CPU speed
-	p = formatFloat(calculatedFreq * 100.f / MSX_CLOCK + 0.5f, heap_top, 0);
-	*p++ = '%';
-	*p++ = ' ';
-	*p = '\0';
-	putstrxy(26,5, heap_top);
+	csprintf(heap_top, "%u%% ", speedPercent);
+	screenUpdate(SCR_PERCENT, 26, 5, strlen(heap_top), heap_top);
 
-	// Prepare line buffer
-	formatSpeedLine(floatStr, calculatedFreq);
+	// Speed line
+	formatSpeedLine(floatStr, speedCentiMhz);
+	screenUpdate(SCR_SPEEDLINE, GR_X+1, GR_Y+1, 30, heap_top);
 
-	// Print speed line
-	waitVBLANK();
-	putlinexy(GR_X+1, GR_Y+1, 30, speedLineStr);
-	waitVBLANK();
-	putlinexy(GR_X+1, GR_Y+1, 30, heap_top);
+	// Statistics of the last samples below the speed line
+	memcpy(heap_top, speedLineStr, 30);
+	p = formatStats(heap_top, true);
+	*p = ' ';
+	screenUpdate(SCR_STATSLINE, GR_X+1, GR_Y+2, 30, heap_top);
 
-	// Print CPU speed in top panel
+	// CPU speed in top panel
 	p = floatStr;
 	while (*p) p++;
 	memcpy(p, " MHz  ", 7);
-	putstrxy(15,5, floatStr);
+	screenUpdate(SCR_MHZ, 15, 5, strlen(floatStr), floatStr);
+
+	// Upload the changed cells in one VBLANK
+	screenFlush();
 }
 
 void msx1_textattr(uint16_t attr) __naked __z88dk_fastcall
@@ -209,11 +184,3 @@ void msx1_textattr(uint16_t attr) __naked __z88dk_fastcall
 		JP_BIOSCALL
 	__endasm;
 }
-
-void msx1_textblink(uint8_t x, uint8_t y, uint16_t length, bool enabled) __naked
-{
-	x, y, length, enabled;
-	__asm
-		ret
-	__endasm;
-}
\ No newline at end of file
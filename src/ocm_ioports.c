@@ -66,4 +66,25 @@ bool ocm_sendSmartCmd(uint8_t cmd) __naked __z88dk_fastcall
 
 		jr .odv_end
 	__endasm;
-}
\ No newline at end of file
+}
+
+uint8_t ocm_readPort(uint8_t port) __naked __z88dk_fastcall
+{
+	port;								// L = Param port
+	__asm
+		in a, (0x40)					; backup current manufacturer/device
+		cpl
+		push af
+
+		ld   c, l						; Store Param port
+		ld   l, #0xd4					; DEVID_OCMPLD
+		call .detectExtIODevice
+
+		ld   l, a
+		or   a
+		jr   z, .odv_end				; Return L = 0:fail
+
+		in   l, (c)						; Return L = port value
+		jr .odv_end
+	__endasm;
+}
@@ -0,0 +1,55 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "dos.h"
+#include "conio.h"
+#include "utils.h"
+#include "overlay.h"
+
+
+static const char *overlayFiles[] = {
+	OVL_NAME".DET", OVL_NAME".CMD", OVL_NAME".PRF"
+};
+
+static uint8_t overlayLoaded = OVL_NONE;
+static uint8_t overlayRunning = OVL_NONE;
+
+extern uint8_t HEAP_start;
+
+
+// ========================================================
+static void overlayLoad(uint8_t id)
+{
+	if (overlayLoaded != id) {
+		if ((uint16_t)&HEAP_start > OVL_ADDR) {
+			die("Overlay area used by the program\n");
+		}
+		if (!fopen((char*)overlayFiles[id])) {
+			cputs(overlayFiles[id]);
+			die(" not found\n");
+		}
+		if (fread((char*)OVL_ADDR, OVL_MAXSIZE) == OVL_MAXSIZE) {		// Truncated
+			cputs(overlayFiles[id]);
+			die(" too big\n");
+		}
+		fclose();
+		overlayLoaded = id;
+	}
+}
+
+uint8_t overlayCall(uint8_t id, char *arg)
+{
+	uint8_t caller = overlayRunning, result;
+
+	overlayLoad(id);
+	overlayRunning = id;
+	result = ((uint8_t (*)(char*))OVL_ADDR)(arg);
+	overlayRunning = caller;
+	if (caller != OVL_NONE) overlayLoad(caller);
+	return result;
+}
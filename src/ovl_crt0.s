@@ -0,0 +1,29 @@
+	;--- Overlay header
+	;    Linked first in every overlay (see overlay.h), so the overlay
+	;    starts at OVL_ADDR with the initialization of its globals and the
+	;    jump to overlayMain(char *arg). The argument arrives in HL.
+
+	.globl	_overlayMain
+
+	.globl  l__INITIALIZER
+	.globl  s__INITIALIZED
+	.globl  s__INITIALIZER
+
+	.area	_CODE
+
+init:
+	push	hl
+	ld		bc,#l__INITIALIZER
+	ld		a,b
+	or		a,c
+	jr		z,start
+	ld		de,#s__INITIALIZED
+	ld		hl,#s__INITIALIZER
+	ldir
+start:
+	pop		hl
+	jp		_overlayMain
+
+	.area	_INITIALIZER
+	.area	_DATA
+	.area	_INITIALIZED
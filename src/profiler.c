@@ -0,0 +1,981 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+
+	Overlay: memory & VDP profilers, called from the command line overlay
+	(see overlay.h)
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "globals.h"
+#include "msx_const.h"
+#include "heap.h"
+#include "dos.h"
+#include "conio.h"
+#include "conio_aux.h"
+#include "utils.h"
+#include "ocm_ioports.h"
+#include "history.h"
+#include "memprof.h"
+#include "overlay.h"
+
+
+// ========================================================
+extern const char *turboRmodeStr[];
+extern const char *vdpTypeStr[];
+extern const char *ocmSpeedsStr[OCM_SPEEDS];
+extern const char *tidesSpeedsStr[];
+
+extern uint8_t  cpuType;
+extern uint8_t  turboRmode;
+extern bool     turboRdetected;
+extern uint8_t  vdpType;
+extern bool     isNTSC;
+extern uint32_t calculatedFreq;
+extern char    *floatStr;
+extern uint32_t frameRate[2];
+extern bool     turboPanaDetected;
+extern bool     ocmDetected;
+extern bool     tidesDetected;
+extern const uint8_t ocmSmartCmd[OCM_SPEEDS];
+extern char   **argValues;
+extern uint8_t  argCount;
+
+void doInterruptLoop();
+void calculateCounterRest();
+void calculateMhz();
+void waitVBLANK();
+
+
+static bool quiet = false;
+
+
+// ========================================================
+static void putPadded(const char *str, uint8_t width)
+{
+	cputs(str);
+	for (uint8_t j=strlen(str); j<width; j++) putch(' ');
+}
+
+
+// ========================================================
+// Memory profiler: throughput of the page 2 RAM of every slot and of every
+// free mapper segment, and the wait states by access that it implies
+
+static const uint16_t memprofCycles[MEMPROF_TESTS] = {
+	MEMPROF_READ_CYCLES, MEMPROF_WRITE_CYCLES, MEMPROF_LDIR_CYCLES
+};
+static const uint16_t memprofAccesses[MEMPROF_TESTS] = {	// Of the tested RAM by block
+	MEMPROF_BLOCK_BYTES, MEMPROF_BLOCK_BYTES, MEMPROF_BLOCK_BYTES*2
+};
+static uint16_t memprofFirst[MEMPROF_TESTS];	// Results of the first segment of a row
+static char     memprofSlotStr[4];
+static char     memprofLabel[20];
+
+static void memprofFormatSlot(uint8_t slot)
+{
+	csprintf(memprofSlotStr, slot & 0x80 ? "%u-%u" : "%u", slot & 3, (slot >> 2) & 3);
+}
+
+// Prints the KB/s of each test, and the wait states when the CPU is a Z80
+// (the test blocks are timed in T-states of a standard MSX Z80)
+static void memprofRow(uint16_t *blocks)
+{
+	uint32_t cycles, expected;
+	uint8_t i;
+
+	putPadded(memprofLabel, 18);
+	for (i=0; i<MEMPROF_TESTS; i++) {
+		formatFixed(mulDiv((uint32_t)blocks[i] * MEMPROF_BLOCK_BYTES, frameRate[isNTSC],
+			MEMPROF_FRAMES * 65536UL * 1024), floatStr, 0);
+		putPadded(floatStr, 8);
+	}
+	if (cpuType == CPU_Z80) {
+		cycles = mulDiv(calculatedFreq, MEMPROF_FRAMES * 65536UL, frameRate[isNTSC]);
+		for (i=0; i<MEMPROF_TESTS; i++) {
+			expected = (uint32_t)blocks[i] * memprofCycles[i];
+			formatFixed(cycles > expected ?
+				mulDiv(cycles - expected, 100, (uint32_t)blocks[i] * memprofAccesses[i]) : 0, floatStr, 2);
+			cprintf(i ? "/%s" : "%s", floatStr);
+		}
+	}
+	putch('\n');
+}
+
+static bool memprofSimilar()
+{
+	for (uint8_t i=0; i<MEMPROF_TESTS; i++) {
+		if (memprofBlocks[i] > memprofFirst[i] + 1 || memprofBlocks[i] + 1 < memprofFirst[i]) return false;
+	}
+	return true;
+}
+
+static void profileMemory()
+{
+	MAPPER_Segment *segments = (MAPPER_Segment*)heap_top;
+	uint16_t count = 0, first = 0, i;
+	uint8_t slot;
+	bool expanded;
+
+	// CPU speed used as reference for the wait states
+	doInterruptLoop();
+	calculateCounterRest();
+	calculateMhz();
+	if (!quiet) {
+		formatFixed(calculatedFreq, floatStr, 6);
+		cprintf("Memory profiler (KB/s, %u frames by test, CPU %s MHz):\n", MEMPROF_FRAMES, floatStr);
+	}
+	cputs("RAM               Read    Write   LDIR    Waits R/W/LDIR\n");
+
+	// Page 2 of every slot and subslot with RAM
+	for (uint8_t p=0; p<4; p++) {
+		expanded = ADDR_POINTER_BYTE(EXPTBL + p) & 0x80;
+		for (uint8_t s=0; s<(expanded ? 4 : 1); s++) {
+			slot = expanded ? 0x80 | (s << 2) | p : p;
+			if (!memprofSlot(slot)) continue;
+			memprofFormatSlot(slot);
+			csprintf(memprofLabel, "Slot %s", memprofSlotStr);
+			memprofRow(memprofBlocks);
+		}
+	}
+
+	// Every free mapper segment, joining the consecutive ones with the same results
+	if (dosVersion() < VER_MSXDOS2x) {
+		if (!quiet) cputs("Mapper segments: MSX-DOS 2 needed\n");
+		return;
+	}
+	mapperInit();
+	while (count < 255 && mapperGetFreeSegments() > 1) {
+		if (mapperAllocateSegment(&segments[count])) break;
+		count++;
+	}
+	for (i=0; i<=count; i++) {
+		if (i < count) memprofSegment(&segments[i]);
+		if (i && (i == count || segments[i].slotAddress != segments[first].slotAddress || !memprofSimilar())) {
+			memprofFormatSlot(segments[first].slotAddress);
+			if (i - first > 1) {
+				csprintf(memprofLabel, "Seg %u-%u @%s", segments[first].segment, segments[i-1].segment, memprofSlotStr);
+			} else {
+				csprintf(memprofLabel, "Seg %u @%s", segments[first].segment, memprofSlotStr);
+			}
+			memprofRow(memprofFirst);
+			first = i;
+		}
+		if (i == first) memcpy(memprofFirst, memprofBlocks, sizeof(memprofFirst));
+	}
+	while (count) {
+		mapperFreeSegment(&segments[--count]);
+	}
+}
+
+
+// ========================================================
+// Execution speed by page & slot: a short loop, copied to RAM or found in a
+// ROM, is called with two iteration counts, and the difference of the time
+// by call gives its speed without the call and slot switching overheads
+
+#define EXEC_LOOPS			3
+#define EXEC_ITERATIONS		255			// Difference of iterations between both counts
+#define EXEC_PAGE0_ADDR		0x00f8		// End of the default DMA buffer
+
+typedef struct {
+	uint8_t  code[6];
+	uint8_t  size;
+	uint8_t  cycles;		// T-states by iteration in a standard MSX Z80
+	uint16_t countLong;		// BC for 256 iterations
+	uint16_t countShort;	// BC for 1 iteration
+} ExecLoop_t;
+
+static const ExecLoop_t execLoops[EXEC_LOOPS] = {
+	{ { 0x10, 0xfe, 0xc9 }, 3, 14, 0x0000, 0x0100 },						// djnz $ / ret
+	{ { 0x0b, 0x78, 0xb1, 0x20, 0xfb, 0xc9 }, 6, 30, 0x0100, 0x0001 },	// dec bc / ld a,b / or c / jr nz / ret
+	{ { 0x0b, 0x79, 0xb0, 0x20, 0xfb, 0xc9 }, 6, 30, 0x0100, 0x0001 },	// dec bc / ld a,c / or b / jr nz / ret
+};
+
+// Speed in Hz of a loop, from its time by call with two BC counts that
+// differ in 'iterations' iterations of 'cycles' T-states
+static uint32_t loopSpeed(uint8_t slot, uint16_t address, uint16_t countLong, uint16_t countShort,
+	uint16_t iterations, uint8_t cycles)
+{
+	uint16_t callsLong = memprofCalls(slot, address, countLong);
+	uint16_t callsShort = memprofCalls(slot, address, countShort);
+	uint32_t freq;
+
+	if (callsShort <= callsLong) return 0;
+	freq = mulDiv((uint32_t)iterations * cycles * callsLong, callsShort, callsShort - callsLong);
+	return mulDiv(freq, frameRate[isNTSC], MEMPROF_FRAMES * 65536UL);
+}
+
+static void execRow(uint8_t page, uint8_t slot, const ExecLoop_t *loop, uint16_t address)
+{
+	uint32_t freq = loopSpeed(slot, address, loop->countLong, loop->countShort, EXEC_ITERATIONS, loop->cycles);
+
+	putPadded(memprofLabel, 18);
+	cprintf("%u     ", page);
+	*(formatFixed(freq, floatStr, 6) - 3) = '\0';		// 3 decimals
+	cprintf("%s MHz  ", floatStr);
+	formatFixed(mulDiv(freq, 100, MSX_CLOCK), floatStr, 2);
+	cprintf("x%s\n", floatStr);
+}
+
+// Copies the loop to a TPA address, and restores the memory after the test
+static void execTPA(uint8_t *address)
+{
+	const ExecLoop_t *loop = &execLoops[0];
+	uint8_t saved[6];
+
+	memcpy(saved, address, loop->size);
+	memcpy(address, loop->code, loop->size);
+	strcpy(memprofLabel, "TPA RAM");
+	execRow((uint16_t)address >> 14, MEMPROF_LOCAL, loop, (uint16_t)address);
+	memcpy(address, saved, loop->size);
+}
+
+// Copies the loop to the page 2 of a slot, if it has RAM
+static void execSlotRAM(uint8_t slot)
+{
+	const ExecLoop_t *loop = &execLoops[0];
+	uint8_t saved[6], value, i;
+
+	value = readSlot(slot, MEMPROF_ADDR);
+	writeSlot(slot, MEMPROF_ADDR, ~value);
+	if (readSlot(slot, MEMPROF_ADDR) != (uint8_t)~value) {
+		writeSlot(slot, MEMPROF_ADDR, value);
+		return;
+	}
+	writeSlot(slot, MEMPROF_ADDR, value);
+
+	for (i=0; i<loop->size; i++) {
+		saved[i] = readSlot(slot, MEMPROF_ADDR + i);
+		writeSlot(slot, MEMPROF_ADDR + i, loop->code[i]);
+	}
+	csprintf(memprofLabel, "Slot %s RAM", memprofSlotStr);
+	execRow(MEMPROF_PAGE, slot, loop, MEMPROF_ADDR);
+	for (i=0; i<loop->size; i++) {
+		writeSlot(slot, MEMPROF_ADDR + i, saved[i]);
+	}
+}
+
+// Looks for a known loop in a ROM page
+static void execSlotROM(uint8_t slot, uint8_t page)
+{
+	uint16_t address = (uint16_t)page << 14, end = address + 0x4000 - 6;
+	const ExecLoop_t *loop;
+	uint8_t value, i, j;
+
+	csprintf(memprofLabel, "Slot %s ROM", memprofSlotStr);
+	for (; address < end; address++) {
+		value = readSlot(slot, address);
+		for (i=0, loop=execLoops; i<EXEC_LOOPS; i++, loop++) {
+			if (value != loop->code[0]) continue;
+			for (j=1; j<loop->size && readSlot(slot, address + j) == loop->code[j]; j++);
+			if (j == loop->size) {
+				execRow(page, slot, loop, address);
+				return;
+			}
+		}
+	}
+	putPadded(memprofLabel, 18);
+	cprintf("%u     no known loop\n", page);
+}
+
+static void profileExec()
+{
+	uint8_t stackCode[6];
+	uint8_t slot, mainRom = ADDR_POINTER_BYTE(EXPTBL);
+	bool expanded;
+
+	if (!quiet) cputs("Execution speed by page & slot:\n");
+	cputs("Code in           Page  Speed\n");
+
+	// TPA RAM of each page: DMA buffer, resident buffer, heap and stack
+	execTPA((uint8_t*)EXEC_PAGE0_ADDR);
+	if ((uint16_t)memprofCode >> 14) execTPA(memprofCode);
+	execTPA(heap_top);
+	execTPA(stackCode);
+
+	// ROM in pages 0-1 (main BIOS, or with a SUB-ROM or ROM header), and RAM in page 2, of every slot
+	for (uint8_t p=0; p<4; p++) {
+		expanded = ADDR_POINTER_BYTE(EXPTBL + p) & 0x80;
+		for (uint8_t s=0; s<(expanded ? 4 : 1); s++) {
+			slot = expanded ? 0x80 | (s << 2) | p : p;
+			memprofFormatSlot(slot);
+			if (slot == mainRom || (readSlot(slot, 0x0000) == 'C' && readSlot(slot, 0x0001) == 'D')) {
+				execSlotROM(slot, 0);
+			}
+			if (slot == mainRom || (readSlot(slot, 0x4000) == 'A' && readSlot(slot, 0x4001) == 'B')) {
+				execSlotROM(slot, 1);
+			}
+			execSlotRAM(slot);
+		}
+	}
+}
+
+
+// ========================================================
+// Access pattern sweep: a read loop copied to the start of a 256 bytes page
+// reads 'size' bytes with a stride, starting at an offset of its own page.
+// In R800 DRAM mode the accesses out of the current DRAM page (256 bytes,
+// also the one of the code) are slower.
+
+#define PATTERN_ROWS		20
+#define PATTERN_CYCLES		34			// T-states by read in a standard MSX Z80
+#define PATTERN_BAR			30			// Width of the longest bar
+
+typedef struct {
+	uint16_t stride;
+	uint16_t align;			// Offset of the first read from the loop page
+	uint16_t size;			// Bytes covered by the size/stride reads (2-256 reads)
+} Pattern_t;
+
+static const Pattern_t patterns[PATTERN_ROWS] = {
+	// Stride
+	{ 1, 0, 32 }, { 2, 0, 64 }, { 4, 0, 128 }, { 8, 0, 256 }, { 16, 0, 512 },
+	{ 32, 0, 1024 }, { 64, 0, 2048 }, { 128, 0, 4096 }, { 256, 0, 8192 },
+	// Alignment
+	{ 1, 16, 32 }, { 1, 128, 32 }, { 1, 224, 32 }, { 1, 240, 32 }, { 1, 256, 32 }, { 1, 1024, 32 },
+	// Size
+	{ 1, 0, 8 }, { 1, 0, 128 }, { 1, 0, 256 }, { 4, 0, 1024 }, { 16, 0, 4096 },
+};
+
+static uint8_t patternCode[] = {
+	0x11, 0, 0,			// ld   de, align
+	0x19,				// add  hl, de
+	0x11, 0, 0,			// ld   de, stride
+	0x7e,				// ld   a, (hl)
+	0x19,				// add  hl, de
+	0x10, 0xfc,			// djnz $-2
+	0xc9				// ret
+};
+
+static uint32_t patternFreq[PATTERN_ROWS];
+
+static void putNumber(uint16_t value, uint8_t width)
+{
+	csprintf(floatStr, "%u", value);
+	putPadded(floatStr, width);
+}
+
+static void profilePattern()
+{
+	uint8_t *base = (uint8_t*)(((uint16_t)heap_top + 0xff) & 0xff00);
+	const Pattern_t *pattern = patterns;
+	uint32_t maxFreq = 1;
+	uint16_t reads;
+	uint8_t i, bar;
+
+	if (!quiet) {
+		cputs("Memory access pattern sweep");
+		if (turboRdetected) cprintf(" (TurboR %s)", turboRmode ? turboRmodeStr[turboRmode] : "Z80");
+		cputs(":\n");
+	}
+	for (i=0; i<PATTERN_ROWS; i++, pattern++) {
+		reads = pattern->size / pattern->stride;
+		patternCode[1] = pattern->align & 0xff;
+		patternCode[2] = pattern->align >> 8;
+		patternCode[5] = pattern->stride & 0xff;
+		patternCode[6] = pattern->stride >> 8;
+		memcpy(base, patternCode, sizeof(patternCode));
+		patternFreq[i] = loopSpeed(MEMPROF_LOCAL, (uint16_t)base, (reads & 0xff) << 8, 0x0100,
+			reads - 1, PATTERN_CYCLES);
+		if (patternFreq[i] > maxFreq) maxFreq = patternFreq[i];
+	}
+
+	cputs("Stride  Align   Size    Speed\n");
+	for (i=0, pattern=patterns; i<PATTERN_ROWS; i++, pattern++) {
+		putNumber(pattern->stride, 8);
+		putNumber(pattern->align, 8);
+		putNumber(pattern->size, 8);
+		*(formatFixed(patternFreq[i], floatStr, 6) - 3) = '\0';		// 3 decimals
+		cprintf("%s MHz ", floatStr);
+		for (bar = mulDiv(patternFreq[i], PATTERN_BAR, maxFreq); bar; bar--) putch('#');
+		putch('\n');
+	}
+}
+
+
+// ========================================================
+// VDP I/O throughput: VRAM writes with OUT, OTIR and unrolled OUTI, and reads
+// with IN and INIR, timed like the memory profiler with the screen on, with
+// the screen off, and only during the vertical blanking (V9938 or higher)
+
+#define VDPIO_TESTS			5
+#define VDPIO_MODES			3
+#define VDPIO_SCREEN_ON		0
+#define VDPIO_SCREEN_OFF	1
+#define VDPIO_VBLANK		2
+#define VDPIO_VRAM_ADDR		0x2000		// Free in the text modes (saved & restored anyway)
+#define VDPIO_BLOCK_BYTES	256
+#define VDPIO_VBLANK_BYTES	32			// Shorter blocks waste less of each blanking
+
+static const char *vdpioTestsStr[VDPIO_TESTS] = {
+	"OUT (98h)", "OTIR", "OUTI x16", "IN (98h)", "INIR"
+};
+
+static uint8_t  vdpioTest;
+static bool     vdpioVblank;
+static uint8_t  vdpioCount;				// Bytes by block (0: 256)
+static uint8_t  vdpioCount8;			// Bytes by block / 8
+static uint16_t vdpioBlocks;
+static uint8_t  vdpioBuffer[VDPIO_BLOCK_BYTES];
+static uint16_t vdpioKBs[VDPIO_TESTS][VDPIO_MODES];
+
+// Runs the test block during MEMPROF_FRAMES frames, or only during the
+// blanking of MEMPROF_FRAMES frames, and stores the blocks done in
+// vdpioBlocks. Each block sets the VRAM address again.
+static void vdpioRun() __naked
+{
+	__asm
+		ld   a, (_vdpioTest)
+		add  a, a
+		ld   l, a
+		ld   h, #0
+		ld   de, #.vpTests
+		add  hl, de
+		ld   a, (hl)
+		inc  hl
+		ld   h, (hl)
+		ld   l, a
+		ld   (#.vpCall+1), hl		; Patch the calls to the test block
+		ld   (#.vpCallBlank+1), hl
+		ld   c, #MEMPROF_FRAMES
+		ld   de, #0
+		di
+		ld   a, (_vdpType)
+		or   a
+		jr   z, .vpNoR14
+		xor  a						; R#14 = 0 (VRAM address bits 14-16)
+		out  (0x99), a
+		ld   a, #0x8e
+		out  (0x99), a
+	.vpNoR14:
+		ld   a, (_vdpioVblank)
+		or   a
+		jr   nz, .vpBlank
+
+		in   a, (0x99)				; Clear the VBLANK flag
+	.vpSync:
+		in   a, (0x99)				; Wait for the start of a frame
+		and  a
+		jp   p, .vpSync
+	.vpLoop:
+	.vpCall:
+		call 0
+		inc  de
+		in   a, (0x99)
+		and  a
+		jp   p, .vpLoop
+		dec  c
+		jp   nz, .vpLoop
+		jr   .vpEnd
+
+	.vpBlank:
+		ld   a, #2					; Read S#2
+		out  (0x99), a
+		ld   a, #0x8f
+		out  (0x99), a
+	.vpActive:
+		in   a, (0x99)				; Wait for the display area...
+		and  #0x40
+		jp   nz, .vpActive
+	.vpFrame:
+		in   a, (0x99)				; ...and for the start of the blanking
+		and  #0x40
+		jp   z, .vpFrame
+	.vpBlankLoop:
+	.vpCallBlank:
+		call 0
+		in   a, (0x99)
+		and  #0x40
+		jp   z, .vpBlankEnd			; Blanking ended during the block: not counted
+		inc  de
+		jp   .vpBlankLoop
+	.vpBlankEnd:
+		dec  c
+		jp   nz, .vpFrame
+		xor  a						; Read S#0 again
+		out  (0x99), a
+		ld   a, #0x8f
+		out  (0x99), a
+
+	.vpEnd:
+		ld   (_vdpioBlocks), de
+		ei
+		ret
+
+	.vpTests:
+		.dw  .vpOut, .vpOtir, .vpOuti, .vpIn, .vpInir
+
+	.vpSetWrite:
+		ld   a, #(VDPIO_VRAM_ADDR & 0xff)
+		out  (0x99), a
+		ld   a, #((VDPIO_VRAM_ADDR >> 8) | 0x40)
+		out  (0x99), a
+		ret
+	.vpSetRead:
+		ld   a, #(VDPIO_VRAM_ADDR & 0xff)
+		out  (0x99), a
+		ld   a, #(VDPIO_VRAM_ADDR >> 8)
+		out  (0x99), a
+		ret
+
+	.vpOut:
+		call .vpSetWrite
+		ld   a, (_vdpioCount8)
+		ld   b, a
+	.vpOut1:
+		out  (0x98), a
+		out  (0x98), a
+		out  (0x98), a
+		out  (0x98), a
+		out  (0x98), a
+		out  (0x98), a
+		out  (0x98), a
+		out  (0x98), a
+		djnz .vpOut1
+		ret
+
+	.vpOtir:
+		call .vpSetWrite
+		ld   hl, #_vdpioBuffer
+		ld   a, (_vdpioCount)
+		ld   b, a
+		ld   c, #0x98
+		otir
+		ret
+
+	.vpOuti:
+		call .vpSetWrite
+		ld   hl, #_vdpioBuffer
+		ld   a, (_vdpioCount)
+		ld   b, a
+		ld   c, #0x98
+	.vpOuti1:
+		outi
+		outi
+		outi
+		outi
+		outi
+		outi
+		outi
+		outi
+		outi
+		outi
+		outi
+		outi
+		outi
+		outi
+		outi
+		outi
+		jp   nz, .vpOuti1
+		ret
+
+	.vpIn:
+		call .vpSetRead
+		ld   a, (_vdpioCount8)
+		ld   b, a
+	.vpIn1:
+		in   a, (0x98)
+		in   a, (0x98)
+		in   a, (0x98)
+		in   a, (0x98)
+		in   a, (0x98)
+		in   a, (0x98)
+		in   a, (0x98)
+		in   a, (0x98)
+		djnz .vpIn1
+		ret
+
+	.vpInir:
+		call .vpSetRead
+		ld   hl, #_vdpioBuffer
+		ld   a, (_vdpioCount)
+		ld   b, a
+		ld   c, #0x98
+		inir
+		ret
+	__endasm;
+}
+
+static void vdpioScreen(bool enabled) __naked __sdcccall(1)
+{
+	enabled;
+	__asm
+		push ix
+		ld   ix, #ENASCR
+		or   a
+		jr   nz, .vpScreen
+		ld   ix, #DISSCR
+	.vpScreen:
+		BIOSCALL
+		pop  ix
+		ret
+	__endasm;
+}
+
+static void profileVdp()
+{
+	uint16_t lines = isNTSC ? 262 : 313;
+	uint16_t active = varRG9SAV.LN ? 212 : 192;
+	uint16_t bytes;
+	uint32_t total;
+	uint8_t test, mode;
+
+	if (!quiet) cprintf("VDP I/O throughput (%s, KB/s):\n", vdpTypeStr[vdpType]);
+
+	_copyVRAMtoRAM(VDPIO_VRAM_ADDR, (uint16_t)heap_top, VDPIO_BLOCK_BYTES);
+	for (mode=0; mode<VDPIO_MODES; mode++) {
+		vdpioVblank = mode == VDPIO_VBLANK;
+		if (vdpioVblank && vdpType == VDP_TMS9918A) break;		// No S#2 to know the blanking
+		if (mode == VDPIO_SCREEN_OFF) vdpioScreen(false);
+		bytes = vdpioVblank ? VDPIO_VBLANK_BYTES : VDPIO_BLOCK_BYTES;
+		vdpioCount = bytes & 0xff;
+		vdpioCount8 = bytes / 8;
+		for (test=0; test<VDPIO_TESTS; test++) {
+			vdpioTest = test;
+			vdpioRun();
+			if (vdpioVblank) {
+				// Bytes by frame time, counting half of the block lost at the end of each blanking
+				total = mulDiv((2UL * vdpioBlocks + MEMPROF_FRAMES) * bytes, lines, 2UL * (lines - active));
+			} else {
+				total = (uint32_t)vdpioBlocks * bytes;
+			}
+			vdpioKBs[test][mode] = mulDiv(total, frameRate[isNTSC], MEMPROF_FRAMES * 65536UL * 1024);
+		}
+		if (mode == VDPIO_SCREEN_OFF) vdpioScreen(true);
+	}
+	_copyRAMtoVRAM((uint16_t)heap_top, VDPIO_VRAM_ADDR, VDPIO_BLOCK_BYTES);
+
+	cputs("Test        Screen on  Screen off  VBLANK\n");
+	for (test=0; test<VDPIO_TESTS; test++) {
+		putPadded(vdpioTestsStr[test], 12);
+		for (mode=0; mode<VDPIO_MODES; mode++) {
+			if (mode == VDPIO_VBLANK && vdpType == VDP_TMS9918A) {
+				cputs("-");
+				continue;
+			}
+			csprintf(floatStr, "%u", vdpioKBs[test][mode]);
+			putPadded(floatStr, mode == VDPIO_SCREEN_ON ? 11 : 12);
+		}
+		putch('\n');
+	}
+}
+
+
+// ========================================================
+// VDP write interval: the shortest gap between VRAM writes that the VDP
+// stores without losing data, at every CPU speed of the turbo devices found.
+// Each pattern writes IV_WRITES bytes after a VBLANK flag (blanking window)
+// or a delay that reaches the display area (active window), and then they
+// are read back with safe gaps.
+
+#define IV_WRITES			32			// VRAM writes by pattern
+#define IV_RUNS				4			// Runs of each pattern, all must pass
+#define IV_SLOW				40			// DJNZ loops between the safe accesses
+#define IV_ACTIVE_US		9000		// From the VBLANK flag to the display area
+#define IV_PATTERNS			18
+
+#define IV_OUT				0			// OUT (98h),A + pad NOPs
+#define IV_OUTC				1			// OUT (C),r back to back
+#define IV_OUTI				2			// OUTI chain
+#define IV_OTIR				3
+
+typedef struct {
+	uint8_t kind;
+	uint8_t pads;						// NOPs after each OUT (98h),A
+	uint8_t cycles;						// T-states between writes (with the M1 wait)
+} Interval_t;
+
+// In decreasing interval order
+static const Interval_t ivPatterns[IV_PATTERNS] = {
+	{ IV_OUT, 40, 212 }, { IV_OUT, 32, 172 }, { IV_OUT, 24, 132 }, { IV_OUT, 20, 112 },
+	{ IV_OUT, 16, 92 },  { IV_OUT, 12, 72 },  { IV_OUT, 10, 62 },  { IV_OUT, 8, 52 },
+	{ IV_OUT, 6, 42 },   { IV_OUT, 5, 37 },   { IV_OUT, 4, 32 },   { IV_OUT, 3, 27 },
+	{ IV_OTIR, 0, 23 },  { IV_OUT, 2, 22 },   { IV_OUTI, 0, 18 },  { IV_OUT, 1, 17 },
+	{ IV_OUTC, 0, 14 },  { IV_OUT, 0, 12 }
+};
+static const uint8_t ivOutcOpcodes[4] = { 0x79, 0x41, 0x51, 0x59 };	// OUT (C),A/B/D/E
+static const uint8_t ivOutcValues[4] = { 0x11, 0x22, 0x33, 0x44 };		// A/B/D/E in ivRun()
+
+static bool     ivActive;
+static uint16_t ivDelay;				// Delay loops from the VBLANK flag to the display area
+static uint8_t *ivCode;					// Generated pattern
+static uint8_t  ivData[IV_WRITES];		// Source of OUTI & OTIR
+static uint8_t  ivExpected[IV_WRITES];
+
+// Sets the VRAM address of the tests, for writing if A != 0, and waits
+// a safe gap before the first access
+static void ivSetAddress(bool write) __naked __sdcccall(1)
+{
+	write;
+	__asm
+		ld   c, a
+		ld   a, (_vdpType)
+		or   a
+		jr   z, .ivNoR14
+		xor  a						; R#14 = 0 (VRAM address bits 14-16)
+		out  (0x99), a
+		ld   a, #0x8e
+		out  (0x99), a
+	.ivNoR14:
+		ld   a, #(VDPIO_VRAM_ADDR & 0xff)
+		out  (0x99), a
+		ld   a, c
+		or   a
+		ld   a, #(VDPIO_VRAM_ADDR >> 8)
+		jr   z, .ivAddress
+		or   #0x40
+	.ivAddress:
+		out  (0x99), a
+		ld   b, #IV_SLOW
+	.ivSettle:
+		djnz .ivSettle
+		ret
+	__endasm;
+}
+
+// Clears the bytes of the test with safe gaps
+static void ivSlowClear() __naked
+{
+	__asm
+		di
+		ld   a, #1
+		call _ivSetAddress
+		ld   c, #IV_WRITES
+	.ivClear:
+		xor  a
+		out  (0x98), a
+		ld   b, #IV_SLOW
+	.ivClearWait:
+		djnz .ivClearWait
+		dec  c
+		jr   nz, .ivClear
+		ei
+		ret
+	__endasm;
+}
+
+// Reads the bytes of the test with safe gaps
+static void ivSlowRead(uint8_t *buffer) __naked __sdcccall(1)
+{
+	buffer;
+	__asm
+		di
+		xor  a
+		call _ivSetAddress
+		ld   c, #IV_WRITES
+	.ivRead:
+		in   a, (0x98)
+		ld   (hl), a
+		inc  hl
+		ld   b, #IV_SLOW
+	.ivReadWait:
+		djnz .ivReadWait
+		dec  c
+		jr   nz, .ivRead
+		ei
+		ret
+	__endasm;
+}
+
+// Runs the generated pattern in the blanking or in the display area
+static void ivRun() __naked
+{
+	__asm
+		di
+		in   a, (0x99)				; Clear the VBLANK flag
+	.ivSync:
+		in   a, (0x99)				; Wait for the start of the blanking
+		and  a
+		jp   p, .ivSync
+		ld   a, (_ivActive)
+		or   a
+		jr   z, .ivStart
+		ld   bc, (_ivDelay)
+	.ivDelay:
+		dec  bc						; 7
+		ld   a, b					; 5
+		or   c						; 5
+		jr   nz, .ivDelay			; 13
+	.ivStart:
+		ld   a, #1
+		call _ivSetAddress
+		ld   iy, (_ivCode)
+		ld   hl, #_ivData
+		ld   c, #0x98
+		ld   a, #0x11
+		ld   b, #0x22
+		ld   de, #0x3344
+		call .ivJump
+		ei
+		ret
+	.ivJump:
+		jp   (iy)
+	__endasm;
+}
+
+// Generates the code of a pattern and the data it must leave in VRAM
+static void ivGenerate(const Interval_t *pattern)
+{
+	uint8_t *p = ivCode;
+
+	if (pattern->kind == IV_OTIR) {
+		*p++ = 0x06;					// ld b,IV_WRITES
+		*p++ = IV_WRITES;
+		*p++ = 0xed;					// otir
+		*p++ = 0xb3;
+	}
+	for (uint8_t i=0; i<IV_WRITES; i++) {
+		switch (pattern->kind) {
+			case IV_OUT:
+				*p++ = 0xd3;			// out (0x98),a
+				*p++ = 0x98;
+				memset(p, 0, pattern->pads);	// nop
+				p += pattern->pads;
+				ivExpected[i] = 0x11;
+				break;
+			case IV_OUTC:
+				*p++ = 0xed;
+				*p++ = ivOutcOpcodes[i & 3];
+				ivExpected[i] = ivOutcValues[i & 3];
+				break;
+			case IV_OUTI:
+				*p++ = 0xed;			// outi
+				*p++ = 0xa3;
+				// fall through
+			default:
+				ivExpected[i] = ivData[i];
+		}
+	}
+	*p = 0xc9;							// ret
+}
+
+// Returns the shortest interval that passes, after all the longer ones,
+// or 0 if even the longest one fails
+static uint8_t ivFind(bool active)
+{
+	uint8_t *buffer = heap_top + VDPIO_BLOCK_BYTES;
+	uint8_t safe = 0;
+
+	ivActive = active;
+	for (uint8_t i=0; i<IV_PATTERNS; i++) {
+		ivGenerate(&ivPatterns[i]);
+		for (uint8_t run=0; run<IV_RUNS; run++) {
+			ivSlowClear();
+			ivRun();
+			ivSlowRead(buffer);
+			if (memcmp(buffer, ivExpected, IV_WRITES)) return safe;
+		}
+		safe = ivPatterns[i].cycles;
+	}
+	return safe;
+}
+
+// Waits for the new turbo mode and prints a row with the safe intervals
+static void ivRow(const char *device, const char *setting)
+{
+	uint8_t safe;
+
+	putPadded(device, 6);
+	putPadded(setting, 8);
+	if (cpuType != CPU_Z80) {
+		cputs("Z80 only\n");
+		return;
+	}
+	for (uint8_t i=0; i<SWEEP_SETTLE; i++) {
+		waitVBLANK();
+	}
+	doInterruptLoop();
+	calculateCounterRest();
+	calculateMhz();
+	ivDelay = mulDiv(calculatedFreq, IV_ACTIVE_US, 30 * 1000000UL);
+	for (uint8_t window=0; window<2; window++) {
+		safe = ivFind(window == 0);
+		if (safe) {
+			csprintf(floatStr, "%uT %luns", (uint16_t)safe, mulDiv(safe, 1000000000UL, calculatedFreq));
+		} else {
+			csprintf(floatStr, ">%uT", (uint16_t)ivPatterns[0].cycles);
+		}
+		putPadded(floatStr, 13);
+	}
+	putch('\n');
+}
+
+// Sweeps every speed of the turbo devices found, and then restores them
+static void profileInterval()
+{
+	uint8_t i, original;
+	bool found = false;
+
+	if (!quiet) cprintf("Minimum safe VDP write interval (%s):\n", vdpTypeStr[vdpType]);
+
+	for (i=0; i<IV_WRITES; i++) {
+		ivData[i] = i + 1;
+	}
+	ivCode = heap_top + VDPIO_BLOCK_BYTES * 2;
+	_copyVRAMtoRAM(VDPIO_VRAM_ADDR, (uint16_t)heap_top, VDPIO_BLOCK_BYTES);
+
+	cputs("Device Setting Active       Blanking\n");
+	if (turboPanaDetected) {
+		original = getTurboPana();
+		for (i=0; i<2; i++) {
+			setTurboPana(i);
+			ivRow("tPANA", i ? "On" : "Off");
+		}
+		setTurboPana(original);
+		found = true;
+	}
+	if (ocmDetected) {
+		original = ocmSpeedIndex();
+		for (i=0; i<OCM_SPEEDS; i++) {
+			ocm_sendSmartCmd(ocmSmartCmd[i]);
+			ivRow("OCM", ocmSpeedsStr[i]);
+		}
+		ocm_sendSmartCmd(ocmSmartCmd[original]);
+		found = true;
+	}
+	if (tidesDetected) {
+		original = getTidesSpeed();
+		for (i=TIDES_3_57MHZ; i<=TIDES_20MHZ; i++) {
+			setTidesSpeed(i | TIDES_SLOTS357);
+			ivRow("Tides", tidesSpeedsStr[i]);
+		}
+		setTidesSpeed(original);
+		found = true;
+	}
+	if (!found) {
+		ivRow("Stock", "");
+	}
+
+	_copyRAMtoVRAM((uint16_t)heap_top, VDPIO_VRAM_ADDR, VDPIO_BLOCK_BYTES);
+}
+
+
+// ========================================================
+uint8_t overlayMain(char *arg)
+{
+	for (uint8_t i=1; i<argCount; i++) {
+		if (!strcmp(argValues[i], "/Q")) quiet = true;
+	}
+	switch (arg[0]) {
+		case 'M':
+			profileMemory();
+			break;
+		case 'E':
+			profileExec();
+			break;
+		case 'P':
+			profilePattern();
+			break;
+		case 'V':
+			profileVdp();
+			break;
+		case 'I':
+			profileInterval();
+			break;
+	}
+	return 0;
+}
@@ -0,0 +1,124 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "dos.h"
+#include "utils.h"
+#include "samples.h"
+
+
+#define EXPORT_LINES		16			// Lines formatted by each disk write
+#define EXPORT_LINE_LEN		24			// "4294967295,4294.967295\r\n"
+
+static MAPPER_Segment segments[SAMPLES_SEGMENTS];
+static uint8_t  segmentsCount = 0;
+static uint16_t capacity;
+static uint16_t head;					// Next sample to write
+static uint16_t count;
+static uint32_t lastTime;				// Seconds of the day of the last sample
+static uint32_t elapsed;
+static char     exportBuffer[EXPORT_LINES * EXPORT_LINE_LEN];
+
+
+// ========================================================
+static uint32_t secondsOfDay()
+{
+	SYSTEMTIME_t time;
+
+	getSystemTime(&time);
+	return time.hours * 3600UL + time.minutes * 60 + time.seconds;
+}
+
+// Maps the segment of a sample in page 2 and returns its address
+static Sample_t *sampleAt(uint16_t idx)
+{
+	mapperSetSegment(SAMPLES_PAGE, &segments[idx >> SAMPLES_SHIFT]);
+	return &((Sample_t*)SAMPLES_ADDR)[idx & (SAMPLES_BY_SEGMENT-1)];
+}
+
+
+// ========================================================
+// Allocates the mapper segments and returns the samples capacity (0: no mapper)
+uint16_t samplesInit()
+{
+	if (dosVersion() < VER_MSXDOS2x) return 0;
+
+	mapperInit();
+	while (segmentsCount < SAMPLES_SEGMENTS && mapperGetFreeSegments() > 1) {
+		if (mapperAllocateSegment(&segments[segmentsCount])) break;
+		segmentsCount++;
+	}
+	capacity = segmentsCount * SAMPLES_BY_SEGMENT;
+	head = 0;
+	count = 0;
+	elapsed = 0;
+	lastTime = secondsOfDay();
+	return capacity;
+}
+
+void samplesFree()
+{
+	while (segmentsCount) {
+		mapperFreeSegment(&segments[--segmentsCount]);
+	}
+	capacity = 0;
+}
+
+void samplesAdd(uint32_t freq)
+{
+	uint32_t now;
+	Sample_t *sample;
+
+	if (!capacity) return;
+
+	// Elapsed time, also across midnight
+	now = secondsOfDay();
+	elapsed += now >= lastTime ? now - lastTime : now + 86400UL - lastTime;
+	lastTime = now;
+
+	sample = sampleAt(head);
+	sample->seconds = elapsed;
+	sample->freq = freq;
+	mapperSetOriginalSegmentBack(SAMPLES_PAGE);
+
+	if (++head == capacity) head = 0;
+	if (count < capacity) count++;
+}
+
+uint16_t samplesCount()
+{
+	return count;
+}
+
+// Writes the samples, from the oldest, as "seconds,MHz" lines
+bool samplesExport()
+{
+	uint16_t idx = count < capacity ? 0 : head;
+	uint16_t left = count;
+	Sample_t *sample;
+	char *p;
+
+	if (!fcreate(SAMPLES_FILE)) return false;
+	fputs("seconds,mhz\r\n");
+	while (left) {
+		p = exportBuffer;
+		for (uint8_t i=0; i<EXPORT_LINES && left; i++, left--) {
+			sample = sampleAt(idx);
+			p = formatFixed(sample->seconds, p, 0);
+			*p++ = ',';
+			p = formatFixed(sample->freq, p, 6);
+			*p++ = '\r';
+			*p++ = '\n';
+			if (++idx == capacity) idx = 0;
+		}
+		mapperSetOriginalSegmentBack(SAMPLES_PAGE);
+		fwrite(exportBuffer, p - exportBuffer);
+	}
+	fclose();
+	return true;
+}
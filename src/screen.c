@@ -0,0 +1,297 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "screen.h"
+#include "conio.h"
+#include "conio_aux.h"
+#include "msx_const.h"
+#include "heap.h"
+
+
+#define BLINK_UNKNOWN	0xff
+
+#define NAMES_SIZE		(80*24)
+#define BLINK_SIZE		(80*24/8)
+#define SYNC_CHUNK		BLINK_SIZE
+
+typedef struct {
+	uint8_t x, y, len;
+	uint8_t newBlinkLen;
+	uint8_t blinkLen[SCR_PAGES];			// Cells with blink in each VRAM page
+	char    newCells[SCR_MAXLEN];
+	char    cells[SCR_PAGES][SCR_MAXLEN];	// Text already in each VRAM page
+} ScreenRegion_t;
+
+static ScreenRegion_t regions[SCR_REGIONS];
+
+void waitVBLANK();
+
+
+#ifndef _MSX1_
+#define HOOK_TIMI		0xfd9f	// H.TIMI: called by the BIOS on each VDP interrupt
+
+// Screen 0[80] pages: name table at 0x0000/0x2000, blink table at 0x0800/0x2800
+static const uint16_t pageNames[SCR_PAGES]  = { 0x0000, 0x2000 };
+static const uint16_t pageBlinks[SCR_PAGES] = { 0x0800, 0x2800 };
+static const uint8_t  pageR2[SCR_PAGES] = { 0x03, 0x0b };
+static const uint8_t  pageR3[SCR_PAGES] = { 0x27, 0xa7 };
+
+static bool    doubleBuffer = false;
+static uint8_t visiblePage = 0;
+static char    syncBuffer[SYNC_CHUNK];
+
+static uint8_t *flipHook;				// Copy of flipHookCode() in the heap
+static volatile uint8_t *flipR2;		// R#2 value to set in the next VBLANK (0: none)
+static uint8_t *flipR3;
+
+
+// ========================================================
+// Shows a page. The interrupts must be disabled.
+static void writePageRegisters(uint8_t r2, uint8_t r3) __naked __sdcccall(1)
+{
+	r2, r3;
+	__asm
+		ld   (RG0SAV+2), a
+		out  (0x99), a
+		ld   a, #0x82
+		out  (0x99), a
+		ld   a, l
+		ld   (RG0SAV+3), a
+		out  (0x99), a
+		ld   a, #0x83
+		out  (0x99), a
+		ret
+	__endasm;
+}
+
+// H.TIMI hook that changes R#2/R#3 when flipR2 is set. It runs from a copy
+// in the heap (0xA000 or above), as the BIOS calls H.TIMI with the main ROM
+// in page 0, and with the disk ROM in page 1 during the disk accesses.
+// The LD HL of the copy is patched with the address of its flipHookR2.
+extern uint8_t flipHookR2Ptr[];
+extern uint8_t flipHookOld[];
+extern uint8_t flipHookR2[];
+extern uint8_t flipHookEnd[];
+
+static void flipHookCode() __naked
+{
+	__asm
+		push af
+		push hl
+		ld   hl, #0
+	_flipHookR2Ptr::
+		ld   a, (hl)
+		or   a
+		jr   z, .flipNone
+		inc  hl
+		ld   a, (hl)				; R#3
+		ld   (RG0SAV+3), a
+		out  (0x99), a
+		ld   a, #0x83
+		out  (0x99), a
+		dec  hl
+		ld   a, (hl)				; R#2
+		ld   (RG0SAV+2), a
+		out  (0x99), a
+		ld   a, #0x82
+		out  (0x99), a
+		ld   (hl), #0
+	.flipNone:
+		pop  hl
+		pop  af
+	_flipHookOld::
+		.ds  5						; Old H.TIMI
+	_flipHookR2::
+		.db  0
+		.db  0						; R#3
+	_flipHookEnd::
+	__endasm;
+}
+
+// The conio blink functions only know the first blink table
+static void setBlink(uint8_t page, uint8_t x, uint8_t y, uint8_t len, bool enabled)
+{
+	uint16_t pos = (y-1) * 80 + (x-1);
+	uint16_t addr = pageBlinks[page] + pos / 8;
+	uint8_t mask = 0x80 >> (pos & 7);
+	uint8_t value = getByteVRAM(addr);
+
+	while (len--) {
+		if (enabled) value |= mask; else value &= ~mask;
+		mask >>= 1;
+		if (!mask) {
+			setByteVRAM(addr++, value);
+			value = getByteVRAM(addr);
+			mask = 0x80;
+		}
+	}
+	setByteVRAM(addr, value);
+}
+#endif	// _MSX1_
+
+
+// ========================================================
+void screenInvalidate()
+{
+	ScreenRegion_t *r = regions;
+	for (uint8_t i=0; i<SCR_REGIONS; i++, r++) {
+		memset(r->cells, 0, sizeof(r->cells));
+		memset(r->blinkLen, BLINK_UNKNOWN, SCR_PAGES);
+		r->len = 0;
+		r->newBlinkLen = BLINK_UNKNOWN;
+	}
+}
+
+void screenForget(uint8_t region)
+{
+	memset(regions[region].cells, 0, sizeof(regions[region].cells));
+}
+
+void screenUpdate(uint8_t region, uint8_t x, uint8_t y, uint8_t len, const char *str)
+{
+	ScreenRegion_t *r = &regions[region];
+
+	r->x = x;
+	r->y = y;
+	r->len = len;
+	memcpy(r->newCells, str, len);
+}
+
+void screenBlink(uint8_t region, uint8_t len)
+{
+	regions[region].newBlinkLen = len;
+}
+
+void screenFlush()
+{
+	ScreenRegion_t *r;
+	uint8_t i, first, last, len, page = 0;
+	char *cells;
+
+#ifdef _MSX1_
+	waitVBLANK();
+#else
+	if (doubleBuffer) {
+		screenWaitFlip();
+		page = visiblePage ^ 1;
+		_current_text_info.vramCharMap = pageNames[page];
+	} else {
+		waitVBLANK();
+	}
+#endif
+
+	for (i=0, r=regions; i<SCR_REGIONS; i++, r++) {
+		// Changed cells
+		cells = r->cells[page];
+		first = 0;
+		last = r->len;
+		while (first < last && r->newCells[first] == cells[first]) first++;
+		if (first < last) {
+			while (r->newCells[last-1] == cells[last-1]) last--;
+			len = last - first;
+			putlinexy(r->x + first, r->y, len, &r->newCells[first]);
+			memcpy(&cells[first], &r->newCells[first], len);
+		}
+#ifndef _MSX1_
+		// Changed blink bits (MSX1 has no blink)
+		len = r->newBlinkLen;
+		last = r->blinkLen[page];
+		if (len == last || len == BLINK_UNKNOWN) continue;
+		if (last == BLINK_UNKNOWN) {
+			setBlink(page, r->x, r->y, SCR_MAXLEN, false);
+			if (len) setBlink(page, r->x, r->y, len, true);
+		} else if (len > last) {
+			setBlink(page, r->x + last, r->y, len - last, true);
+		} else {
+			setBlink(page, r->x + len, r->y, last - len, false);
+		}
+		r->blinkLen[page] = len;
+#endif
+	}
+
+#ifndef _MSX1_
+	// Show the new page in the next VBLANK
+	if (doubleBuffer) {
+		visiblePage = page;
+		*flipR3 = pageR3[page];
+		*flipR2 = pageR2[page];
+	}
+#endif
+}
+
+
+// ========================================================
+#ifndef _MSX1_
+void screenPagesInit()
+{
+	uint16_t size = flipHookEnd - (uint8_t*)flipHookCode;
+
+	flipHook = malloc(size);
+	memcpy(flipHook, flipHookCode, size);
+	flipR2 = flipHook + (flipHookR2 - (uint8_t*)flipHookCode);
+	flipR3 = (uint8_t*)flipR2 + 1;
+	*(uint16_t*)(flipHook + (flipHookR2Ptr - (uint8_t*)flipHookCode) - 2) = (uint16_t)flipR2;
+	memcpy(flipHook + (flipHookOld - (uint8_t*)flipHookCode), (void*)HOOK_TIMI, 5);
+
+	ASM_DI;
+	*(uint16_t*)(HOOK_TIMI+1) = (uint16_t)flipHook;
+	*(uint8_t*)HOOK_TIMI = 0xc3;				// jp flipHook
+	ASM_EI;
+
+	doubleBuffer = true;
+	visiblePage = 0;
+	screenSync();
+}
+
+void screenPagesRestore()
+{
+	if (!doubleBuffer) return;
+
+	ASM_DI;
+	memcpy((void*)HOOK_TIMI, flipHook + (flipHookOld - (uint8_t*)flipHookCode), 5);
+	*flipR2 = 0;
+	writePageRegisters(pageR2[0], pageR3[0]);
+	ASM_EI;
+
+	doubleBuffer = false;
+	visiblePage = 0;
+	_current_text_info.vramCharMap = pageNames[0];
+}
+
+void screenWaitFlip()
+{
+	if (doubleBuffer) {
+		while (*flipR2);
+	}
+}
+
+void screenSync()
+{
+	uint8_t hidden = visiblePage ^ 1;
+	uint16_t offset;
+	ScreenRegion_t *r = regions;
+
+	if (!doubleBuffer) return;
+	screenWaitFlip();
+	_current_text_info.vramCharMap = pageNames[visiblePage];
+
+	// Copy the visible page over the hidden one
+	for (offset=0; offset<NAMES_SIZE; offset+=SYNC_CHUNK) {
+		_copyVRAMtoRAM(pageNames[visiblePage] + offset, (uint16_t)syncBuffer, SYNC_CHUNK);
+		_copyRAMtoVRAM((uint16_t)syncBuffer, pageNames[hidden] + offset, SYNC_CHUNK);
+	}
+	_copyVRAMtoRAM(pageBlinks[visiblePage], (uint16_t)syncBuffer, BLINK_SIZE);
+	_copyRAMtoVRAM((uint16_t)syncBuffer, pageBlinks[hidden], BLINK_SIZE);
+
+	for (uint8_t i=0; i<SCR_REGIONS; i++, r++) {
+		memcpy(r->cells[hidden], r->cells[visiblePage], SCR_MAXLEN);
+		r->blinkLen[hidden] = r->blinkLen[visiblePage];
+	}
+}
+#endif	// _MSX1_
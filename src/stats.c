@@ -0,0 +1,138 @@
+/*
+	Copyright (c) 2024 Natalia Pujol Cremades
+	info@abitwitches.com
+
+	See LICENSE file.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "stats.h"
+
+
+// Student's t(0.975, n-1) / sqrt(n) * 1000, for n = 2..STATS_SAMPLES
+static const uint16_t ci95Factor[STATS_SAMPLES-1] = {
+	8984, 2484, 1591, 1241, 1050, 925, 836, 769, 715, 672, 635, 604, 577, 554, 533
+};
+
+static uint32_t samples[STATS_SAMPLES];
+static uint8_t  samplesHead;
+static uint8_t  samplesTotal;
+static uint32_t sorted[STATS_SAMPLES];
+static uint32_t deviation[STATS_SAMPLES];
+
+
+// ========================================================
+static void sortSamples(uint32_t *values, uint8_t count)
+{
+	uint32_t value;
+	int8_t j;
+
+	for (uint8_t i=1; i<count; i++) {
+		value = values[i];
+		for (j=i-1; j>=0 && values[j] > value; j--) {
+			values[j+1] = values[j];
+		}
+		values[j+1] = value;
+	}
+}
+
+static uint32_t medianOf(uint32_t *values, uint8_t count)
+{
+	sortSamples(values, count);
+	if (count & 1) {
+		return values[count / 2];
+	}
+	return (values[count/2 - 1] + values[count/2]) / 2;
+}
+
+static uint16_t isqrt(uint32_t value)
+{
+	uint32_t result = 0;
+	uint32_t bit = 1UL << 30;
+
+	while (bit > value) bit >>= 2;
+	while (bit) {
+		if (value >= result + bit) {
+			value -= result + bit;
+			result = (result >> 1) + bit;
+		} else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+	return result;
+}
+
+
+// ========================================================
+void statsReset()
+{
+	samplesHead = 0;
+	samplesTotal = 0;
+}
+
+void statsAdd(uint32_t freq)
+{
+	samples[samplesHead] = freq;
+	samplesHead = (samplesHead + 1) % STATS_SAMPLES;
+	if (samplesTotal < STATS_SAMPLES) samplesTotal++;
+}
+
+void statsCalculate(Stats_t *stats)
+{
+	uint8_t i, n, shift;
+	uint32_t median, window, value, sum, maxDev;
+
+	memset(stats, 0, sizeof(Stats_t));
+	stats->total = samplesTotal;
+	if (!samplesTotal) return;
+
+	// Median & Median Absolute Deviation of all the samples
+	memcpy(sorted, samples, samplesTotal * sizeof(uint32_t));
+	median = medianOf(sorted, samplesTotal);
+	for (i=0; i<samplesTotal; i++) {
+		value = sorted[i];
+		deviation[i] = value > median ? value - median : median - value;
+	}
+	window = medianOf(deviation, samplesTotal) * STATS_MAD_FACTOR;
+	if (window < median / STATS_MAD_MIN) {
+		window = median / STATS_MAD_MIN;
+	}
+
+	// Discard outliers (sorted[] keeps its order, so min/max are the ends)
+	n = 0;
+	sum = 0;
+	for (i=0; i<samplesTotal; i++) {
+		value = sorted[i];
+		if ((value > median ? value - median : median - value) <= window) {
+			sorted[n++] = value;
+			sum += value;
+		}
+	}
+	stats->count = n;
+	stats->min = sorted[0];
+	stats->max = sorted[n-1];
+	stats->median = (n & 1) ? sorted[n/2] : (sorted[n/2 - 1] + sorted[n/2]) / 2;
+	stats->mean = (sum + n/2) / n;
+	if (n < 2) return;
+
+	// Sample standard deviation, scaled down to keep the squares in 32 bits
+	maxDev = stats->max - stats->mean;
+	if (stats->mean - stats->min > maxDev) maxDev = stats->mean - stats->min;
+	for (shift=0; (maxDev >> shift) >= 16384; shift++);
+	sum = 0;
+	for (i=0; i<n; i++) {
+		value = sorted[i] > stats->mean ? sorted[i] - stats->mean : stats->mean - sorted[i];
+		value >>= shift;
+		sum += value * value;
+	}
+	stats->stddev = (uint32_t)isqrt(sum / (n-1)) << shift;
+
+	// 95% confidence interval of the mean
+	if (stats->stddev < 0x40000UL) {
+		stats->ci95 = stats->stddev * ci95Factor[n-2] / 1000;
+	} else {
+		stats->ci95 = stats->stddev / 1000 * ci95Factor[n-2];
+	}
+}
@@ -2,7 +2,6 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
-#include <math.h>
 #include "globals.h"
 #include "msx_const.h"
 #include "heap.h"
@@ -12,58 +11,164 @@
 #include "ocm_ioports.h"
 #include "msx1_functions.h"
 #include "patterns.h"
+#include "kernels.h"
+#include "stats.h"
+#include "screen.h"
+#include "overlay.h"
+#include "history.h"
 #include "z80bench.h"
+#include "speedglyphs.h"
+#ifndef _MSX1_
+	#include "panel80.h"
+#endif
 
 
 /**
- * Variables and functions that vary from MSX1 to MSX2 or higher.
+ * Screen parameters that vary from MSX1 to MSX2 or higher. The binary for each
+ * generation is selected at compile time (-D_MSX1_ builds the MSX1 one, and
+ * msx1_functions.h maps the UI functions to their MSX1 versions).
  */
-uint8_t screenMode = BW80;
-uint16_t blinkBase = 0x0800;
-uint16_t patternsBase = 0x1000;
-void (*drawCpuSpeed_ptr)();
-void (*drawPanel_ptr)();
-void (*showCPUtype_ptr)();
-void (*showVDPtype_ptr)();
-void (*textattr_ptr)(uint16_t attr) __z88dk_fastcall;
-void (*textblink_ptr)(uint8_t x, uint8_t y, uint16_t length, bool enabled);
+#ifdef _MSX1_
+	#define SCREEN_MODE		BW40
+	#define PATTERNS_BASE	0x0800
+#else
+	#define SCREEN_MODE		BW80
+	#define PATTERNS_BASE	0x1000
+	#define BLINK_BASE		0x0800
+#endif
 
 /**
  * Variables for calculating CPU speed.
+ * int_counter holds the number of interrupts counted by the ISR, and is turned
+ * into fixed point 16.16 by calculateCounterRest(). calculatedFreq is in Hz.
  */
 static uint8_t vdpFreq;
-float calculatedFreq = 0;
+uint32_t calculatedFreq = 0;
 uint8_t speedLineScale = 1;
-uint64_t int_counter = 0;
-uint64_t counterRestHL = 0;
+uint32_t int_counter = 0;
+uint16_t counterRestHL = 0;
 
 /**
- * Pointer to a string buffer used to hold a floating-point value as a string.
- * This is likely used for displaying the floating-point value in a formatted
+ * Constants of the CPU speed calculation, precomputed for the current kernel
+ * and frame rate, so each measurement only needs one mulDiv().
+ */
+static uint8_t  speedKernel = 0xff;
+static uint32_t speedCycles;			// T-states of one test loop in a MSX Z80
+static uint32_t speedFps;				// Frame rate (fixed point 16.16)
+static uint16_t speedOffset;			// Hz used by the ISR
+
+/**
+ * Statistics of the last measured samples. The samples buffer is reset every
+ * time the test conditions change (CPU speed, kernel, timing, video mode...).
+ */
+Stats_t stats;
+
+/**
+ * Test loop length. It's fixed to LOOP2 unless the adaptive mode is enabled,
+ * then it's recalculated after each test to reach the target precision
+ * (units of 0.01%) without exceeding the time budget (seconds).
+ */
+uint8_t  loopCount = LOOP2;
+bool     adaptiveLoop = false;
+uint16_t adaptPrecision = ADAPT_PRECISION;
+uint8_t  adaptBudget = ADAPT_BUDGET;
+
+/**
+ * Timing engine used to measure the test.
+ * The scanlines engine is only available with V9938 or higher, and counts the
+ * scanlines from the end of the test to the next vertical retrace.
+ * The TurboR timer engine reads the S1990 system timer (3.911us) at the start
+ * and the end of the test. The VBLANK result of the same test is kept in
+ * vblankFreq to cross-check it.
+ */
+uint8_t  timingEngine = TIMING_VBLANK;
+uint16_t lineRest;
+uint16_t timerStart;
+uint16_t timerEnd;
+uint32_t vblankFreq = 0;
+
+/**
+ * VDP frame rates used by the calculations, indexed by isNTSC (fixed point 16.16).
+ * They start with the nominal values, and can be replaced for the session by
+ * the ones measured using the RP5C01 RTC as wall-clock reference.
+ */
+uint32_t frameRate[2] = { PAL_FPS, NTSC_FPS };
+bool     rtcDetected;
+bool     rtcCalibrated = false;
+uint8_t  rtcSeconds = RTC_CALIB_SECONDS;
+uint16_t rtcSpinFrame;
+uint16_t rtcSpinStart;
+uint16_t rtcSpinEnd;
+uint16_t rtcIntsStart;
+uint16_t rtcIntsEnd;
+
+/**
+ * Variables for the instruction-mix test kernels.
+ * The kernel block routine and its number of calls per test loop are patched
+ * into the test harness, and the spin counters are used to calculate the
+ * fraction of the last frame used by the test.
+ */
+uint8_t  kernelIdx = KERNEL_DECHL;
+void   (*kernelRun)();
+uint16_t kernelBlocks;
+uint16_t kernelTailSpin;
+uint16_t kernelFrameSpin;
+
+/**
+ * Keyboard events. The test ISR scans the rows 6 & 7 of the keyboard matrix
+ * and latches in keyEdges the keys pressed since the last scan (low byte:
+ * row 6, high byte: row 7), and in keyShift the row 6 state at the last press.
+ * readKeyEvents() moves them to a small queue handled by the main loop.
+ * If keyAbort is set, a key press also aborts the running test at once.
+ */
+#define KEY_NONE		0
+#define KEY_F1			1
+#define KEY_F2			2
+#define KEY_F3			3
+#define KEY_F4			4
+#define KEY_F5			5
+#define KEY_F6			6
+#define KEY_F7			7
+#define KEY_F8			8
+#define KEY_F9			9
+#define KEY_ESC			10
+#define KEYQUEUE_LEN	8
+uint16_t keyRows = 0xffff;
+uint16_t keyEdges;
+uint8_t  keyShift;
+bool     keyAbort = false;
+bool     testAborted;
+static uint8_t keyQueue[KEYQUEUE_LEN];
+static uint8_t keyQueueHead;
+static uint8_t keyQueueTail;
+
+/**
+ * Pointer to a string buffer used to hold a fixed-point value as a string.
+ * This is likely used for displaying the fixed-point value in a formatted
  * way, such as in a user interface.
  */
-#define FLOATSTR_LEN	8
+#define FLOATSTR_LEN	12
 char  *floatStr;
 
+/**
+ * Display values of the last sample, calculated once by updateSpeedDisplay()
+ * so the UI only needs integer operations.
+ */
+uint16_t speedCentiMhz;				// MHz x100
+uint16_t speedPercent;				// % of a MSX Z80
+
 /**
  * Stores the MSX version of the ROM.
  * This variable is likely used to determine the capabilities and features of the
  * MSX system the program is running on, in order to adapt the behavior and
  * presentation accordingly.
  */
-#define MSX_1		0
-#define MSX_2		1
-#define MSX_2P		2
-#define MSX_TR		3
 uint8_t msxVersionROM;
 uint8_t machineBrand;
 
 /**
  * Stores the current CPU type of the MSX system.
  */
-#define CPU_Z80		0
-#define CPU_R800	1
-#define CPU_Z280	2
 uint8_t cpuType = CPU_Z80;
 bool    isCMOS;
 
@@ -77,24 +182,21 @@ bool    isNTSC;
  * Stores a flag indicating whether the TurboPana feature has been detected.
  * TurboPana is a hardware enhancement for the MSX2+ allowing CPU to run at 5.36MHz.
  */
-static bool turboPanaDetected;
+bool turboPanaDetected;
 static bool turboPanaEnabled = false;
 
 /**
  * Stores the current TurboR mode of the MSX system.
  */
-#define TR_Z80			0			// The system is running in Z80 mode.
-#define TR_R800_ROM		1			// The system is running in R800 ROM mode.
-#define TR_R800_DRAM	2			// The system is running in R800 DRAM mode.
-static uint8_t turboRmode = TR_Z80;
-static bool    turboRdetected;
+uint8_t turboRmode = TR_Z80;
+bool    turboRdetected;
 
 /**
  * Stores a flag indicating whether the OCM (oneChipMSX/MSX++) has been detected.
  * OCM firmware allows multiple CPU custom speeds:
  * 3.57MHz, 4.10MHz, 4.48MHz, 4.90MHz, 5.39MHz, 6.10MHz, 6.96MHz, 8.06MHz.
  */
-static bool ocmDetected;
+bool ocmDetected;
 static uint8_t ocmSpeedIdx = -1;
 
 /**
@@ -102,9 +204,24 @@ static uint8_t ocmSpeedIdx = -1;
  * Tides-Rider is a MSX2+ board allowing the CPU to run at:
  * 3.57MHz, 6.66MHz, 10MHz, 20MHz.
  */
-static bool tidesDetected;
+bool tidesDetected;
 static uint8_t tidesSpeed = TIDES_20MHZ;
 
+/**
+ * Frames spent by each platform detection probe (fixed point 8.8, see
+ * detect.c), and a flag telling if the detection was taken from the cache
+ * file instead.
+ */
+uint16_t probeTicks[PROBE_COUNT];
+bool     detectCached;
+uint16_t machineFingerprint;			// BIOS ROM checksum (see detect.c)
+
+/**
+ * Command line arguments, parsed by the command line overlay (see cmdline.c).
+ */
+char   **argValues;
+uint8_t  argCount;
+
 /**
  * Stores the original values of various system variables before they are modified.
  * These variables are used to restore the system state when the program exits.
@@ -123,11 +240,13 @@ void drawCpuSpeed();
 void drawPanel();
 void showCPUtype();
 void showVDPtype();
+void showKernel();
+void showLoopMode();
 bool detectNTSC();
 
 
 // ========================================================
-static void checkPlatformSystem()
+static void saveSystemState()
 {
 	originalLINL40 = varLINL40;
 	originalCRTCNT = varCRTCNT;
@@ -136,67 +255,6 @@ static void checkPlatformSystem()
 	originalBAKCLR = varBAKCLR;
 	originalBDRCLR = varBDRCLR;
 	originalCLIKSW = varCLIKSW;
-
-	// Check MSX2 ROM or higher
-	msxVersionROM = getRomByte(MSXVER);
-
-	// VDP type
-	vdpType = detectVDP();
-	if (!msxVersionROM && vdpType >= VDP_V9938) {	// for MSX1 with V9938 or higher
-		varRG9SAV.raw = 0;
-		varRG9SAV.NT = !(getRomByte(LOCALE) >> 7);
-		setNTSC(varRG9SAV.NT);
-	}
-
-	// Configure dynamics functions
-	if (!msxVersionROM) {
-		screenMode = BW40;
-		blinkBase = 0x4000;
-		patternsBase = 0x0800;
-		drawCpuSpeed_ptr = msx1_drawCpuSpeed;
-		drawPanel_ptr = msx1_drawPanel;
-		showCPUtype_ptr = msx1_showCPUtype;
-		showVDPtype_ptr = msx1_showVDPtype;
-		textattr_ptr = msx1_textattr;
-		textblink_ptr = msx1_textblink;
-	} else {
-		screenMode = BW80;
-		blinkBase = 0x0800;
-		patternsBase = 0x1000;
-		drawCpuSpeed_ptr = drawCpuSpeed;
-		drawPanel_ptr = drawPanel;
-		showCPUtype_ptr = showCPUtype;
-		showVDPtype_ptr = showVDPtype;
-		textattr_ptr = textattr;
-		textblink_ptr = textblink;
-	}
-
-	// Check CPU type
-	cpuType = detectCPUtype();
-
-	// Check MSX2+ w/tPANA
-	turboPanaDetected = detectTurboPana();
-
-	// Check TurboR
-	turboRdetected = detectTurboR();
-	if (turboRdetected) {
-		turboRmode = getCpuTurboR();
-	}
-
-	// Check OCM-PLD/MSX++
-	ocmDetected = ocm_detectDevice(DEVID_OCMPLD);
-
-	// Check Tides-Rider
-	tidesDetected = detectTidesRider();
-
-	// Machine type
-	machineBrand = detectMachineBrand();
-
-	// NTSC/PAL
-	isNTSC = detectNTSC();
-
-	// Detect if Z80 is NMOS/CMOS
-	isCMOS = detectNMOS();
 }
 
 uint8_t detectCPUtype()
@@ -206,22 +264,11 @@ uint8_t detectCPUtype()
 	return CPU_Z80;
 }
 
-uint8_t detectMachineBrand()
+bool isTimingAvailable(uint8_t engine)
 {
-	if (ocmDetected) {
-		return BRAND_OCMPLD;
-	}
-	uint8_t result = 0;
-	uint8_t port40 = 255 - inportb(0x40);
-	for (uint8_t i=1; i<=26; i++) {
-		outportb(0x40, i);
-		if (inportb(0x40) == 255 - i) {
-			result = i;
-			break;
-		}
-	}
-	outportb(0x40, port40);
-	return result;
+	return engine == TIMING_VBLANK ||
+		(engine == TIMING_LINES && vdpType >= VDP_V9938) ||
+		(engine == TIMING_TRTIMER && turboRdetected);
 }
 
 bool detectNTSC()
@@ -232,6 +279,13 @@ bool detectNTSC()
 	);
 }
 
+void selectKernel(uint8_t idx)
+{
+	kernelIdx = idx;
+	kernelRun = kernels[idx].run;
+	kernelBlocks = kernels[idx].blocks;
+}
+
 void abortRoutine()
 {
 	restoreScreen();
@@ -241,12 +295,13 @@ void abortRoutine()
 void putstrxy(uint8_t x, uint8_t y, char *str)
 {
 	if (!*str) return;
+	screenWaitFlip();
 	putlinexy(x, y, strlen(str), str);
 }
 
 inline void redefineCharPatterns()
 {
-	_copyRAMtoVRAM((uint16_t)charPatters, patternsBase+0x80*8, 19*8);
+	_copyRAMtoVRAM((uint16_t)charPatters, PATTERNS_BASE+0x80*8, 19*8);
 }
 
 void waitVBLANK() __naked
@@ -264,6 +319,32 @@ void waitVBLANK() __naked
 
 
 // ========================================================
+void updateSpeedDisplay()
+{
+	speedCentiMhz = calculatedFreq / 10000;
+	speedPercent = mulDiv(calculatedFreq + MSX_CLOCK/200, 100, MSX_CLOCK);
+}
+
+char *formatStats(char *str, bool compact)
+{
+	static const char *labels[] = { " min ", " med ", " max ", " sd ", " \xf1" };
+	uint32_t *values[] = { &stats.min, &stats.median, &stats.max, &stats.stddev, &stats.ci95 };
+
+	csprintf(str, compact ? "n%u" : "n=%u/%u", stats.count, stats.total);
+	str += strlen(str);
+	for (uint8_t i=0; i<sizeof(labels)/sizeof(labels[0]); i++) {
+		if (compact && i != 1 && i != 4) continue;		// Median & CI only
+		strcpy(str, labels[i]);
+		str += strlen(str);
+		str = formatFixed(*values[i], str, 6) - (i < 3 ? 3 : 2);	// Truncate to 3/4 decimals
+		*str = '\0';
+	}
+	return str;
+}
+
+
+// ========================================================
+#ifndef _MSX1_
 
 void showCPUtype()
 {
@@ -286,34 +367,45 @@ void showVDPtype()
 	putstrxy(17,6, heap_top);
 }
 
+void showKernel()
+{
+	csprintf(heap_top, "original MSX Z80 (%s).     ", kernels[kernelIdx].name);
+	putstrxy(42,4, heap_top);
+}
+
+void showLoopMode()
+{
+	csprintf(heap_top, "[F7] Loop x%u %s  ", loopCount, adaptiveLoop ? "auto" : "fixed");
+	putstrxy(31,20, heap_top);
+	if (vdpType >= VDP_V9938) {
+		csprintf(heap_top, "[F8] %s  ", timingEngineStr[timingEngine]);
+		putstrxy(52,20, heap_top);
+	}
+	putstrxy(42,6, timingEngine == TIMING_TRTIMER ? "VBLANK check: --                   " : info2Str);
+	screenForget(SCR_CHECKLINE);
+}
+
 // ========================================================
 #define GR_X	17
 #define GR_Y	8
 #define GR_H	9
-#define LABELSY_X 	GR_X-13
-#define LABELSY_Y 	GR_Y
 
-uint16_t formatSpeedLine(char *floatStr, float speed)
+uint16_t formatSpeedLine(char *floatStr, uint16_t speed)
 {
-	uint16_t speedUnits = (uint16_t)(speed * 2.f / speedLineScale);
-	float speedDecimal = speed / speedLineScale - speedUnits * 0.5f;
+	uint16_t cell = 50 * speedLineScale;			// 0.5 MHz by cell (MHz x100)
+	uint16_t speedUnits = speed / cell;
 	char *q = heap_top, *p;
 
 	// Prepare line buffer
 	memcpy(q, speedLineStr, 60);
 	memset(q, '\x8e', speedUnits);
 	q += speedUnits;
-	for (uint8_t i=0; i<sizeof(speedDecLimits); i++) {
-		if (speedDecimal <= speedDecLimits[i]) {
-			*q = '\x88'+i;
-			break;
-		}
-	}
+	*q = speedGlyph[(speed - speedUnits * cell) / speedLineScale];
 	*++q = ' ';
 	q++;
 
 	// Print speed numbers
-	p = formatFloat(speed, floatStr, 2);
+	p = formatFixed(speed, floatStr, 2);
 	memcpy(q, floatStr, p-floatStr);
 
 	return q-heap_top + p-floatStr;
@@ -324,6 +416,8 @@ void updateScale()
 	char *floatStr = malloc(FLOATSTR_LEN);
 	char *p = heap_top;
 
+	screenWaitFlip();
+
 	// X labels
 	memset(heap_top, ' ', 54);
 	char mhz[] = "MHz";
@@ -333,16 +427,15 @@ void updateScale()
 			*mhz = '\0';
 			offset++;
 		}
-		formatFloat(i*speedLineScale*5.f, floatStr, 0);
-		csprintf(p+offset, "%s%s", floatStr, mhz);
+		csprintf(p+offset, "%u%s", i*speedLineScale*5, mhz);
 		p+=10;
 	}
 	putlinexy(GR_X+8, GR_Y+GR_H+1, 54, heap_top);
 
 	// Draw fixed graphs
-	formatSpeedLine(floatStr, MSX_CLOCK);		// 3.57 MHz
+	formatSpeedLine(floatStr, MSX_CLOCK/10000);		// 3.57 MHz
 	putlinexy(GR_X+1, GR_Y+4, 60, heap_top);
-	formatSpeedLine(floatStr, MSX_CLOCK*1.5f);	// 5.36 MHz
+	formatSpeedLine(floatStr, MSX_CLOCK*3/20000);	// 5.36 MHz
 	putlinexy(GR_X+1, GR_Y+7, 60, heap_top);
 
 	free(floatStr);
@@ -350,39 +443,14 @@ void updateScale()
 
 void drawPanel()
 {
-	uint16_t i;
+	screenInvalidate();
 
+	// Static panel prebuilt by bin/panelimage.c
+	rleUnpack(panel80Names, heap_top);
+	rleUnpack(panel80Blink, heap_top + PANEL80_NAMES_SIZE);
 	waitVBLANK();
-
-	// Big frame
-	_fillVRAM(0, 80, '\x80');
-	_fillVRAM(23*80, 80, '\x80');
-	for (i=79; i<23*80; i+=80) {
-		_fillVRAM(i, 2, '\x81\x81');
-	}
-	setByteVRAM(0, '\x82');
-	setByteVRAM(79, '\x83');
-	setByteVRAM(23*80, '\x84');
-	setByteVRAM(23*80+79, '\x85');
-
-	// Title
-	uint16_t len = strlen(titleStr);
-	putlinexy(5, 1, len, titleStr);
-	textblink(6, 1, len-2, true);
-
-	// Author
-	putlinexy(66, 1, 13, authorStr);
-
-	// Info
-	drawFrame(3,2, 39,7);
-	putstrxy(5,3, infoMachineStr);
-	putstrxy(5,4, infoCpuTypeStr);
-	putstrxy(5,5, "CPU Speed : --");
-	putstrxy(5,6, infoVdpTypeStr);
-	textblink(16,3, 23, true);
-	textblink(16,4, 23, true);
-	textblink(16,5, 23, true);
-	textblink(16,6, 23, true);
+	_copyRAMtoVRAM((uint16_t)heap_top, 0x0000, PANEL80_NAMES_SIZE);
+	_copyRAMtoVRAM((uint16_t)heap_top + PANEL80_NAMES_SIZE, BLINK_BASE, PANEL80_BLINK_SIZE);
 
 	// Machine type
 	if (machineBrand == 0) {
@@ -399,38 +467,15 @@ void drawPanel()
 	showVDPtype();
 
 	// Info frame
-	drawFrame(40, 2, 78, 7);
-	putstrxy(42, 3, "This computer performs ---% of an");
-	putstrxy(42, 4, "original MSX Z80.");
-	putstrxy(42, 5, info1Str);
-	putstrxy(42, 6, info2Str);
-	textblink(65,3, 5, true);
-
-	// Graph
-	chlinexy(GR_X,GR_Y+GR_H, 58);
-	cvlinexy(GR_X,GR_Y, GR_H);
-	putlinexy(GR_X,GR_Y+GR_H, 1, "\x1a");
-
-	// Axis X
-	for (i=1; i<7; i++) {
-		putlinexy(GR_X+i*10-9,GR_Y+GR_H, 10, "\x91\x90\x91\x90\x91\x90\x91\x90\x91\x8f");
-	}
-
-	// Y labels
-	for (i=0; i<9; i++) {
-		putlinexy(GR_X+1, LABELSY_Y+i, 60, speedLineStr);
-		putstrxy(LABELSY_X, LABELSY_Y+i, axisYLabelsStr[i]);
+	showKernel();
+	if (rtcDetected) {
+		putstrxy(42, 5, "[F9] Calibrate frame rate w/RTC  ");
 	}
 
 	// Update scale (X labels & fixed graphs)
 	updateScale();
 
-	// Change color of current CPU speed
-	textblink(GR_X+1, GR_Y+1, 79-(GR_X+1), true);
-
 	// Key labels
-	chlinexy(2, 21, 78);
-
 	if (turboPanaDetected) {
 		putstrxy(3,22, "[F1] Toggle");
 		putstrxy(3,23, "tPANA speed");
@@ -451,11 +496,7 @@ void drawPanel()
 		putstrxy(42,23, "Tides Speed");
 	}
 
-	putstrxy(68,22, "[F6] Toggle");
-	putstrxy(68,23, "NTSC/PAL");
-
-	putstrxy(3, 20, "Hold keys until click sound");
-	putstrxy(65, 20, "[ESC] to exit");
+	showLoopMode();
 }
 
 void drawCpuSpeed()
@@ -463,62 +504,73 @@ void drawCpuSpeed()
 	char *p;
 
 	// Draw counter in top-right border
-	csprintf(heap_top, "\x86 %lu \x87\x80\x80", int_counter);
-	putstrxy(50,1, heap_top);
+	csprintf(heap_top, "\x86 %lu \x87\x80\x80", INTS_x1E4(int_counter));
+	screenUpdate(SCR_COUNTER, 50, 1, strlen(heap_top), heap_top);
 
 	// Draw % of CPU speed
-	p = formatFloat(calculatedFreq * 100.f / MSX_CLOCK + 0.5f , heap_top, 0);
-	*p++ = '%';
-	*p++ = ' ';
-	*p = '\0';
-	putstrxy(65,3, heap_top);
+	csprintf(heap_top, "%u%% ", speedPercent);
+	screenUpdate(SCR_PERCENT, 65, 3, strlen(heap_top), heap_top);
 
 	// Format line & calculate scale
 	uint16_t len;
 	uint8_t oldLineScale = speedLineScale;
 	speedLineScale = 1;
 	do {
-		len = formatSpeedLine(floatStr, calculatedFreq);
+		len = formatSpeedLine(floatStr, speedCentiMhz);
 		if (len > 60) { speedLineScale*=2; continue; }
 		break;
 	} while (true);
 
-	// Update scale if changed
-	waitVBLANK();
-	if (oldLineScale != speedLineScale) {
-		malloc(60);
-		updateScale();
-		freeSize(60);
-	}
+	// Speed line & text blink
+	screenUpdate(SCR_SPEEDLINE, GR_X+1, GR_Y+1, 60, heap_top);
+	screenBlink(SCR_SPEEDLINE, len < 60 ? len : 60);
 
-	// Clear text blink & wait
-	textblink(GR_X+1, GR_Y+1, 79-(GR_X+1), false);
-	waitVBLANK();
+	// Statistics of the last samples below the speed line
+	memcpy(heap_top, speedLineStr, 60);
+	p = formatStats(heap_top, false);
+	*p = ' ';
+	screenUpdate(SCR_STATSLINE, GR_X+1, GR_Y+2, 60, heap_top);
 
-	// Print speed line & set text blink
-	putlinexy(GR_X+1, GR_Y+1, 60, heap_top);
-	textblink(GR_X+1, GR_Y+1, (len < 60 ? len : 60), true);
-
-	// Print CPU speed in top panel
+	// CPU speed in top panel
 	p = floatStr;
 	while (*p) p++;
 	memcpy(p, " MHz   ", 8);
-	putstrxy(17,5, floatStr);
+	screenUpdate(SCR_MHZ, 17, 5, strlen(floatStr), floatStr);
+
+	// VBLANK cross-check of the TurboR timer
+	if (timingEngine == TIMING_TRTIMER) {
+		bool negative = calculatedFreq < vblankFreq;
+		uint32_t deviation = mulDiv(negative ? vblankFreq - calculatedFreq : calculatedFreq - vblankFreq, 10000, vblankFreq);
+		formatFixed(vblankFreq / 10000, floatStr, 2);
+		csprintf(heap_top, "VBLANK check: %s MHz (%s", floatStr, negative ? "-" : "+");
+		p = formatFixed(deviation, heap_top+strlen(heap_top), 2);
+		memcpy(p, "%)   ", 6);
+		screenUpdate(SCR_CHECKLINE, 42, 6, strlen(heap_top), heap_top);
+	}
+
+	// Upload the changed cells to the hidden page
+	screenFlush();
+
+	// Update scale if changed
+	if (oldLineScale != speedLineScale) {
+		updateScale();
+		screenSync();
+	}
 }
 
+#endif	// _MSX1_
+
+
 // ========================================================
 void doInterruptLoop() __naked
 {
 	__asm
-		ld   hl, #0					; Counter = 0 (64 bits long)
+		ld   hl, #0					; Counter = 0 (32 bits long)
 		ld   (_int_counter), hl
 		ld   (_int_counter+2), hl
-		ld   (_int_counter+4), hl
-		ld   (_int_counter+6), hl
-		ld   (_counterRestHL), hl	; CounterRest = 0 (64 bits long)
-		ld   (_counterRestHL+2), hl
-		ld   (_counterRestHL+4), hl
-		ld   (_counterRestHL+6), hl
+		ld   (_counterRestHL), hl	; CounterRest = 0
+		xor  a
+		ld   (_testAborted), a
 
 		ei
 		halt						; Wait interruption to change the hook
@@ -531,8 +583,24 @@ void doInterruptLoop() __naked
 		ei
 		halt						; Important to have stable values (skip first interrupt)
 
-		xor  a						; Test loop
-		ld   b, #LOOP2
+		ld   a, (_timingEngine)		; TurboR timer?
+		cp   #TIMING_TRTIMER
+		jr   nz, .startTest
+		call .readTimer
+		ld   (_timerStart), hl
+
+	.startTest:
+		ld   a, (_kernelIdx)		; Instruction-mix kernel selected?
+		or   a
+		jp   nz, .kernelLoop
+
+		ld   (#.testSP), sp			; Arm the abort by key press
+		ld   a, (_keyAbort)
+		ld   (#.testArmed), a
+
+		ld   a, (_loopCount)		; Test loop
+		ld   b, a
+		xor  a
 	.loop1:
 		ld   hl, #0xffff
 	.loop2:
@@ -543,6 +611,14 @@ void doInterruptLoop() __naked
 		jp   nz, .loop2
 		djnz .loop1
 
+		call .readTimerEnd
+		ld   a, (_timingEngine)		; Scanlines timing?
+		cp   #TIMING_LINES
+		call z, .countLines
+
+	.endTest:
+		xor  a						; Disarm the abort by key press
+		ld   (#.testArmed), a
 		ld   hl, (#.rstBackup)		; End test
 		ld   (#0x38+1), hl			; Restore original interrupt hook
 		ei
@@ -552,6 +628,130 @@ void doInterruptLoop() __naked
 
 		ret
 
+	// ######### KERNEL TEST LOOP #########
+	.kernelLoop:
+		push ix						; Kernels can modify IX & IY
+		push iy
+		ld   (#.testSP), sp			; Arm the abort by key press
+		ld   a, (_keyAbort)
+		ld   (#.testArmed), a
+		ld   hl, (_kernelRun)		; Patch the call to the kernel block
+		ld   (#.kernelCall+1), hl
+
+		ld   a, (_loopCount)		; Test loop
+	.kloop1:
+		push af
+		ld   hl, (_kernelBlocks)
+	.kloop2:
+		push hl
+	.kernelCall:
+		call 0						; Run kernel block
+		pop  hl
+		dec  hl
+		ld   a, h
+		or   l
+		jp   nz, .kloop2
+		pop  af
+		dec  a
+		jp   nz, .kloop1
+
+		call .readTimerEnd
+		ld   a, (_timingEngine)		; Scanlines timing?
+		cp   #TIMING_LINES
+		jr   nz, .kernelSpin
+		call .countLines
+		jr   .kernelEnd
+
+	.kernelSpin:
+		ld   hl, (_int_counter)		; Nr. of interrupts at the end of the test
+		push hl
+		ld   c, l
+		call .spinToInterrupt		; Spin until the next interrupt (residual)
+		ld   (_kernelTailSpin), hl
+		ld   a, (_int_counter)
+		ld   c, a
+		call .spinToInterrupt		; Spin during a whole frame
+		ld   (_kernelFrameSpin), hl
+		pop  hl
+		ld   (_int_counter), hl
+
+	.kernelEnd:
+		pop  iy
+		pop  ix
+		jp   .endTest
+
+	.spinToInterrupt:				; IN: C=int_counter LSB | OUT: HL=spins
+		ld   hl, #0
+	.spinLoop:
+		inc  hl
+		ld   a, (_int_counter)
+		cp   c
+		jp   z, .spinLoop
+		ret
+
+	// ######### TURBOR SYSTEM TIMER #########
+	.readTimerEnd:
+		ld   a, (_timingEngine)
+		cp   #TIMING_TRTIMER
+		ret  nz
+		call .readTimer
+		ld   (_timerEnd), hl
+		ret
+
+	.readTimer:						; OUT: HL=S1990 timer
+		in   a, (0xe7)				; Read MSB, LSB and MSB again to avoid
+		ld   h, a					; a wrong value if the LSB overflows
+		in   a, (0xe6)
+		ld   l, a
+		in   a, (0xe7)
+		cp   h
+		jr   nz, .readTimer
+		ret
+
+	// ######### SCANLINES COUNTER (V9938 or higher) #########
+	.countLines:					; OUT: lineRest=scanlines to the next vertical retrace
+		di
+		in   a, (0x99)				; Read S#0: count the VBLANK interrupt if it is pending
+		and  #0b10000000
+		jr   z, .noPendingInt
+		ld   hl, (_int_counter)
+		inc  hl
+		ld   (_int_counter), hl
+	.noPendingInt:
+		ld   a, #2					; Select S#2
+		out  (0x99), a
+		ld   a, #15+0x80
+		out  (0x99), a
+
+		ld   hl, #0
+	.linesInRetrace:				; Count scanlines while in vertical retrace (VR=1)
+		call .waitScanline
+		inc  hl
+		bit  6, a
+		jr   nz, .linesInRetrace
+	.linesInDisplay:				; Count scanlines until the vertical retrace starts
+		call .waitScanline
+		inc  hl
+		bit  6, a
+		jr   z, .linesInDisplay
+		ld   (_lineRest), hl
+
+		xor  a						; Select S#0 as required by BIOS
+		out  (0x99), a
+		ld   a, #15+0x80
+		out  (0x99), a
+		ret							; Interrupts are enabled again by .endTest
+
+	.waitScanline:					; Wait the next horizontal retrace | OUT: A=S#2
+		in   a, (0x99)
+		and  #0b00100000			; Wait HR=0
+		jr   nz, .waitScanline
+	.waitScanline2:
+		in   a, (0x99)
+		bit  5, a					; Wait HR=1
+		jr   z, .waitScanline2
+		ret
+
 	// ######### INTERRUPT ROUTINE #########
 	.intRoutine:					; Code is now here
 		push hl						; Save registers that are modified
@@ -565,6 +765,37 @@ void doInterruptLoop() __naked
 		inc  hl						; Increase counter by one
 		ld   (_int_counter), hl
 
+		in   a, (0xaa)				; Read keyboard rows 6 & 7 (0=pressed)
+		and  #0xf0					;   Row 6: F3 F2 F1 CODE CAPS GRAPH CTRL SHIFT
+		or   #6						;   Row 7: RET SEL BS STOP TAB ESC F5 F4
+		ld   h, a
+		out  (0xaa), a
+		in   a, (0xa9)
+		ld   l, a
+		inc  h
+		ld   a, h
+		out  (0xaa), a
+		in   a, (0xa9)
+		ld   h, a
+
+		push bc						; Latch the keys pressed since the last scan
+		ld   bc, (_keyRows)
+		ld   (_keyRows), hl
+		ld   a, l
+		cpl
+		and  c
+		and  #0b11100000			; F1..F3
+		ld   c, a
+		ld   a, h
+		cpl
+		and  b
+		and  #0b00000111			; F4, F5, ESC
+		ld   b, a
+		or   c
+		jr   nz, .keyPressed
+	.keyEnd:
+		pop  bc
+
 	.notFromVDP:
 		pop  af						; Restore modified registers
 		pop  hl
@@ -573,98 +804,370 @@ void doInterruptLoop() __naked
 
 		ei							; Interrupts are permitted again
 		ret							; Return to main program
+
+	.keyPressed:					; IN: BC=new keys pressed, L=row 6
+		ld   a, l
+		ld   (_keyShift), a
+		ld   hl, (_keyEdges)
+		ld   a, l
+		or   c
+		ld   l, a
+		ld   a, h
+		or   b
+		ld   h, a
+		ld   (_keyEdges), hl
+		ld   a, (#.testArmed)		; Abort the running test?
+		or   a
+		jr   z, .keyEnd
+
+		ld   sp, (#.testSP)			; Discard the stack of the test & the ISR
+		ld   a, #1
+		ld   (_testAborted), a
+		ld   a, (_kernelIdx)
+		or   a
+		jp   z, .endTest
+		pop  iy
+		pop  ix
+		jp   .endTest
 	.intRoutEnd:					; For Length of routine code
 
 	.rstBackup:
 		.ds 2
+	.testSP:
+		.ds 2
+	.testArmed:
+		.db 0
 	__endasm;
 }
 
 void calculateCounterRest() {
-	// Calculate decimals with counterRestHL
-	int_counter = (counterRestHL * 1000000ULL / (((655350ULL)-counterRestHL)/int_counter)) + int_counter * 1000000ULL;
+	uint32_t fraction;
+	if (timingEngine == TIMING_LINES) {
+		// Calculate decimals with the scanlines of the last frame used by the test
+		uint16_t lines = detectNTSC() ? NTSC_FRAME_LINES : PAL_FRAME_LINES;
+		uint16_t rest = lineRest < lines ? lines - lineRest : 0;
+		fraction = ((uint32_t)rest << 16) / lines;
+	} else
+	if (kernelIdx != KERNEL_DECHL) {
+		// Calculate decimals with the fraction of the last frame used by the kernel
+		uint16_t rest = kernelTailSpin < kernelFrameSpin ? kernelFrameSpin - kernelTailSpin : 0;
+		fraction = ((uint32_t)rest << 16) / kernelFrameSpin;
+	} else {
+		// Calculate decimals with counterRestHL
+		uint32_t countsByInt = (65535UL * loopCount - counterRestHL) / int_counter;
+		fraction = ((uint32_t)counterRestHL << 16) / countsByInt;
+	}
+	int_counter = (int_counter << 16) + fraction;
+}
+
+void updateSpeedConstants()
+{
+	uint32_t fps = frameRate[isNTSC];
+	if (speedKernel == kernelIdx && speedFps == fps) return;
+
+	speedKernel = kernelIdx;
+	speedFps = fps;
+	if (kernelIdx != KERNEL_DECHL) {
+		speedCycles = kernelLoopCycles(kernelIdx);
+		speedOffset = (ISR_CYCLES * fps) >> 16;							// T-states of the ISR by second
+	} else {
+		speedCycles = TESTLOOP_CYCLES;
+		speedOffset = (isNTSC ? 8437 : 6724)							// offsets for NTSC/PAL (Hz)
+			+ ((ISR_KEYS_CYCLES * fps) >> 16);							//   + keyboard scan
+	}
 }
 
 void calculateMhz()
 {
 	isNTSC = detectNTSC();
-	uint64_t reference = isNTSC ? 905922538492488ULL : 758316840607900ULL;	// constants for 3.58 MHz NTSC/PAL (fixed point 1e6)
-	uint64_t offset = isNTSC ? 8437ULL : 6724ULL;						// offsets for NTSC/PAL (fixed point 1e6)
+	updateSpeedConstants();
+
+	// Hz = cycles * fps / interrupts (both fps & interrupts in fixed point 16.16).
+	// The loops multiply the fps, as the cycles of a test can overflow 32 bits.
+	calculatedFreq = mulDiv(speedCycles, (uint32_t)loopCount * speedFps, int_counter) + speedOffset;
+
+	if (timingEngine == TIMING_TRTIMER) {
+		// Resolve the wraps of the 16 bits timer (every 256ms) with the VBLANK measurement
+		uint32_t ticks = (uint16_t)(timerEnd - timerStart);
+		uint32_t estimated = mulDiv(int_counter, isNTSC ? NTSC_TRTIMER_TICKS : PAL_TRTIMER_TICKS, 65536000UL);
+		if (estimated > ticks) {
+			ticks += (estimated - ticks + 0x8000) & 0xffff0000;
+		}
+		vblankFreq = calculatedFreq;
+		calculatedFreq = mulDiv(speedCycles, (uint32_t)loopCount * TRTIMER_CLOCK, ticks * TRTIMER_DIVIDER) + speedOffset;
+	}
+}
 
-	calculatedFreq = (uint32_t)(reference / int_counter + offset) / 1000000.f;
+void adaptLoopCount()
+{
+	if (!adaptiveLoop) return;
+
+	// Interrupts needed to reach the target precision, and allowed by the time budget (fixed point 16.16)
+	uint32_t intsPerLoop = int_counter / loopCount;
+	uint32_t target = (timingEngine == TIMING_LINES ? LINES_UNCERTAINTY : TIMING_UNCERTAINTY) * 10000UL / adaptPrecision;
+	uint32_t budget = adaptBudget * frameRate[isNTSC];
+
+	uint32_t loops = (target + intsPerLoop - 1) / intsPerLoop;
+	if (loops * intsPerLoop > budget) loops = budget / intsPerLoop;
+	if (loops < 1) loops = 1;
+	if (loops > 255) loops = 255;
+	loopCount = loops;
 }
 
 
 // ========================================================
-void commandLine(char type)
+void measureRTCframes() __naked
 {
-	*((char*)&titleStr[strlen(titleStr)-2]) = '\0';
-	*((char*)&authorStr[11]) = '\0';
-	cprintf("%s (by %s)\n", &titleStr[2], &authorStr[2]);
+	__asm
+		ld   hl, #0					; Counter = 0
+		ld   (_int_counter), hl
 
-	if (type != 'd' && type != 'D') {
-		die("\nz80bench [d]\n\n"
-			"  <none>: Run GUI mode (default)\n"
-			"  d:      Run Command line Debug mode\n");
+		ei
+		halt						; Wait interruption to change the hook
+
+		di							; Change the VBLANK interrupt hook
+		ld   hl, (#0x38+1)
+		ld   (#.rstBackup), hl
+		ld   hl, #.intRoutine
+		ld   (#0x38+1), hl
+
+		ei
+
+		halt						; Spins by frame
+		ld   a, (_int_counter)
+		ld   c, a
+		call .spinToInterrupt
+		ld   (_rtcSpinFrame), hl
+
+		call .waitRTCsecond			; Start: spins from a RTC second to the next interrupt
+		ld   a, (_int_counter)
+		ld   c, a
+		call .spinToInterrupt
+		ld   (_rtcSpinStart), hl
+		ld   hl, (_int_counter)
+		ld   (_rtcIntsStart), hl
+
+		ld   a, (_rtcSeconds)		; Wait N seconds
+		ld   b, a
+	.rtcSecondsLoop:
+		call .waitRTCsecond
+		djnz .rtcSecondsLoop
+
+		ld   a, (_int_counter)		; End: spins from the last RTC second to the next interrupt
+		ld   c, a
+		call .spinToInterrupt
+		ld   (_rtcSpinEnd), hl
+		ld   hl, (_int_counter)
+		ld   (_rtcIntsEnd), hl
+
+		di
+		ld   hl, (#.rstBackup)		; Restore original interrupt hook
+		ld   (#0x38+1), hl
+		ei
+		ret
+
+	.waitRTCsecond:					; Wait until the RTC seconds change
+		push bc
+		call .readRTCsecond
+		ld   e, a
+	.waitRTCsecond2:
+		push de
+		call .readRTCsecond
+		pop  de
+		cp   e
+		jr   z, .waitRTCsecond2
+		pop  bc
+		ret
+	.readRTCsecond:					; OUT: A=seconds (units)
+		ld   a, #RTC_SECONDS_UNITS
+		ld   l, #0
+		call _getRegisterRTC
+		and  #0x0f
+		ret
+	__endasm;
+}
+
+uint32_t calibrateFrameRate()
+{
+	// The RTC must count while it is measured: the mode is restored after
+	uint8_t mode = getModeRTC();
+	setRegisterRTC(RTC_MODE, 0, mode | RTC_TIMER_ENABLE);
+	measureRTCframes();
+	setRegisterRTC(RTC_MODE, 0, mode);
+
+	// Frames between the first and the last RTC seconds (fixed point 16.16)
+	uint32_t frames = ((uint32_t)(uint16_t)(rtcIntsEnd - rtcIntsStart) << 16)
+		+ mulDiv(rtcSpinStart, 65536UL, rtcSpinFrame) - mulDiv(rtcSpinEnd, 65536UL, rtcSpinFrame);
+
+	uint32_t fps = frames / rtcSeconds;
+	uint32_t nominal = isNTSC ? NTSC_FPS : PAL_FPS;
+
+	// A rate far from the nominal one is a bad measure: keep the current rate
+	if (fps < nominal - nominal / RTC_CALIB_TOLERANCE || fps > nominal + nominal / RTC_CALIB_TOLERANCE) {
+		return 0;
 	}
+	frameRate[isNTSC] = fps;
+	rtcCalibrated = true;
+	return fps;
+}
 
-	// Machine type
-	cputs(infoMachineStr);
-	if (machineBrand == 0) {
-		cprintf("%s\n", machineTypeStr[msxVersionROM]);
-	} else {
-		cprintf("%s (%s)\n", machineTypeStr[msxVersionROM], machineBrandStr[machineBrand]);
+char *formatFrameRate(char *str, uint32_t fps)
+{
+	uint32_t nominal = isNTSC ? NTSC_FPS : PAL_FPS;
+	bool negative = fps < nominal;
+	uint32_t ppm = mulDiv(negative ? nominal - fps : fps - nominal, 1000000UL, nominal);
+
+	char *p = formatFixed(mulDiv(fps, 10000, 65536), str, 4);
+	csprintf(p, "Hz (%s%lu ppm)", negative ? "-" : "+", ppm);
+	return str;
+}
+
+void showRTCcalibration()
+{
+	putstrxy(42,5, "Calibrating with RTC...            ");
+	if (!calibrateFrameRate()) {
+		putstrxy(42,5, "RTC: out of range, nominal rate    ");
+		return;
 	}
-	// CPU type
-	cputs(infoCpuTypeStr);
-	if (turboRmode) {
-		cprintf("%s (%s)", cpuTypesStr[cpuType], turboRmodeStr[turboRmode]);
-	} else {
-		if (cpuType == CPU_Z80) {
-			cprintf("%s(%s)", cpuTypesStr[cpuType], cmosStr[isCMOS]);
+	csprintf(heap_top, "RTC: %s      ", formatFrameRate(floatStr, frameRate[isNTSC]));
+	putstrxy(42,5, heap_top);
+}
+
+
+// ========================================================
+void readKeyEvents()
+{
+	static const uint16_t keyMasks[] = {		// F1..F5 & ESC in keyEdges
+		0x0020, 0x0040, 0x0080, 0x0100, 0x0200, 0x0400
+	};
+	uint16_t edges;
+	bool shift;
+	uint8_t key, next;
+
+	ASM_DI;
+	edges = keyEdges;
+	shift = !(keyShift & 1);
+	keyEdges = 0;
+	ASM_EI;
+
+	for (uint8_t i=0; i<sizeof(keyMasks)/sizeof(keyMasks[0]); i++) {
+		if (!(edges & keyMasks[i])) continue;
+		if (i == 5) {
+			key = KEY_ESC;
 		} else {
-			cputs(cpuTypesStr[cpuType]);
+			key = KEY_F1 + i + (shift && i < 4 ? 5 : 0);		// SHIFT+F1..F4 = F6..F9
 		}
+		next = (keyQueueTail + 1) % KEYQUEUE_LEN;
+		if (next == keyQueueHead) break;						// Queue full
+		keyQueue[keyQueueTail] = key;
+		keyQueueTail = next;
 	}
-	putch('\n');
-	// Video mode
-	cputs(infoVdpTypeStr);
-	cprintf("%s %s\n", vdpTypeStr[vdpType], vdpModesStr[detectNTSC()]);
-	
-	// CPU speed test
-	cputs("Running TestLoop v"TESTLOOP_VERSION":\n");
-
-	doInterruptLoop();
-	calculateCounterRest();
-
-	uint32_t cnt = int_counter;
-	for (int32_t i=cnt+20000; i>=cnt-20000; i+=-10000) {
-		int_counter = i;
-		calculateMhz();
-		formatFloat(calculatedFreq, floatStr, 6);
-		cprintf("%s %lu: %s MHz\n", i==cnt?"->":"  ", i, floatStr);
+}
+
+uint8_t nextKeyEvent()
+{
+	if (keyQueueHead == keyQueueTail) return KEY_NONE;
+	uint8_t key = keyQueue[keyQueueHead];
+	keyQueueHead = (keyQueueHead + 1) % KEYQUEUE_LEN;
+	return key;
+}
+
+bool handleKey(uint8_t key)
+{
+	switch (key) {
+		// F1: Toggle tPANA speed
+		case KEY_F1:
+			if (!turboPanaDetected) break;
+			turboPanaEnabled = !turboPanaEnabled;
+			setTurboPana(turboPanaEnabled);
+			return true;
+		// F2: Cycle TurboR CPU
+		case KEY_F2:
+			if (!turboRdetected) break;
+			turboRmode++;
+			if (turboRmode > TR_R800_DRAM) turboRmode = TR_Z80;
+			setCpuTurboR(turboRmode);
+			cpuType = detectCPUtype();
+			isCMOS = detectNMOS();
+			showCPUtype();
+			if (!kernelIsAvailable(kernelIdx, cpuType == CPU_R800)) {
+				selectKernel(KERNEL_DECHL);
+				showKernel();
+			}
+			return true;
+		// F3: Cycle OCM Speed
+		case KEY_F3:
+			if (!ocmDetected) break;
+			ocmSpeedIdx = ++ocmSpeedIdx % sizeof(ocmSmartCmd);
+			ocm_sendSmartCmd(ocmSmartCmd[ocmSpeedIdx]);
+			return true;
+		// F4: Toggle Tides Speed
+		case KEY_F4:
+			if (!tidesDetected) break;
+			tidesSpeed = ++tidesSpeed % 4;
+			setTidesSpeed(tidesSpeed | TIDES_SLOTS357);
+			return true;
+		// F5: Cycle test kernel
+		case KEY_F5: {
+			uint8_t idx = kernelIdx;
+			do {
+				idx = (idx + 1) % KERNEL_COUNT;
+			} while (!kernelIsAvailable(idx, cpuType == CPU_R800));
+			selectKernel(idx);
+			showKernel();
+			return true;
+		}
+		// F6: Toggle NTSC/PAL
+		case KEY_F6:
+			if (!(vdpType >= VDP_V9938)) break;
+			isNTSC = !detectNTSC();
+			setNTSC(isNTSC);
+			showVDPtype();
+			return true;
+		// F7: Toggle adaptive test loop
+		case KEY_F7:
+			adaptiveLoop = !adaptiveLoop;
+			if (!adaptiveLoop) loopCount = LOOP2;
+			showLoopMode();
+			return true;
+		// F8: Cycle timing engine
+		case KEY_F8:
+			if (!(vdpType >= VDP_V9938)) break;
+			do {
+				timingEngine = (timingEngine + 1) % TIMING_ENGINES;
+			} while (!isTimingAvailable(timingEngine));
+			showLoopMode();
+			return true;
+		// F9: Calibrate frame rate with RTC
+		case KEY_F9:
+			if (!(rtcDetected && msxVersionROM)) break;
+			showRTCcalibration();
+			return true;
 	}
+	return false;
 }
 
 
 // ========================================================
 int main(char **argv, int argc) __sdcccall(0)
 {
-	argv, argc;
-
 	// A way to avoid using low memory when using BIOS calls from DOS
 	if (heap_top < (void*)0xa000)
 		heap_top = (void*)0xa000;
 
 	floatStr = malloc(FLOATSTR_LEN);
+	selectKernel(KERNEL_DECHL);
+
+	argValues = argv;
+	argCount = argc;
 
 	//Platform system checks
-	checkPlatformSystem();
+	saveSystemState();
+	overlayCall(OVL_DETECT, argc ? argv[0] : NULL);
 
 	// Command line
 	if (argc != 0) {
-		commandLine(argv[0][0]);
-		return 0;
+		return overlayCall(OVL_CMDLINE, argv[0]);
 	}	
 
 	// Set abort exit routine
@@ -677,58 +1180,69 @@ int main(char **argv, int argc) __sdcccall(0)
 	}
 
 	// Initialize screen 0[80]
-	textmode(screenMode);
-	textattr_ptr(0xa4f4);
+	textmode(SCREEN_MODE);
+#ifdef _MSX1_
+	msx1_textattr(0xa4f4);
+#else
+	textattr(0xa4f4);
+#endif
 	setcursortype(NOCURSOR);
 	memset((char*)FNKSTR, 0, 160);			// Redefine Function Keys to empty strings
 	redefineCharPatterns();
 	varCLIKSW = 0;
 
 	// Initialize header & panel
-	drawPanel_ptr();
+	drawPanel();
+
+	// Double buffered panel in 80 columns
+	screenPagesInit();
+
+	// Key presses abort the running test
+	keyAbort = true;
 
 //int_counter = 220;
+	uint8_t key, oldLoopCount, turbo;
+	bool redraw;
 	do {
 		doInterruptLoop();
-		calculateCounterRest();
-		calculateMhz();
-		drawCpuSpeed_ptr();
-		click();
+		if (!testAborted) {
+			calculateCounterRest();
+			calculateMhz();
+			statsAdd(calculatedFreq);
+			statsCalculate(&stats);
+			updateSpeedDisplay();
+			drawCpuSpeed();
+			click();
+
+			if (adaptiveLoop) {
+				oldLoopCount = loopCount;
+				adaptLoopCount();
+				if (loopCount != oldLoopCount) {
+					showLoopMode();
+					screenSync();
+				}
+			}
+		}
 //getch();
 //int_counter--;
 
-		// F1: Toggle tPANA speed
-		if (!varNEWKEY_row6.f1 && varNEWKEY_row6.shift && turboPanaDetected) {
-			turboPanaEnabled = !turboPanaEnabled;
-			setTurboPana(turboPanaEnabled);
-		} else
-		// F2: Cycle TurboR CPU
-		if (!varNEWKEY_row6.f2 && varNEWKEY_row6.shift && turboRdetected) {
-			turboRmode++;
-			if (turboRmode > TR_R800_DRAM) turboRmode = TR_Z80;
-			setCpuTurboR(turboRmode);
-			cpuType = detectCPUtype();
-			isCMOS = detectNMOS();
-			showCPUtype_ptr();
-		} else
-		// F3: Cycle OCM Speed
-		if (!varNEWKEY_row6.f3 && varNEWKEY_row6.shift && ocmDetected) {
-			ocmSpeedIdx = ++ocmSpeedIdx % sizeof(ocmSmartCmd);
-			ocm_sendSmartCmd(ocmSmartCmd[ocmSpeedIdx]);
-		} else
-		// F4: Toggle Tides Speed
-		if (!varNEWKEY_row7.f4 && varNEWKEY_row6.shift && tidesDetected) {
-			tidesSpeed = ++tidesSpeed % 4;
-			setTidesSpeed(tidesSpeed | TIDES_SLOTS357);
-		} else
-		// F6: Toggle NTSC/PAL
-		if (!varNEWKEY_row6.f1 && !varNEWKEY_row6.shift && vdpType >= VDP_V9938) {
-			isNTSC = !detectNTSC();
-			setNTSC(isNTSC);
-			showVDPtype_ptr();
+		// Handle the keys pressed during the test
+		readKeyEvents();
+		redraw = false;
+		while ((key = nextKeyEvent()) != KEY_NONE && key != KEY_ESC) {
+			turbo = historyTurbo();
+			if (handleKey(key)) {
+				if (stats.total) historyAdd('G', turbo, stats.median, 0);
+				statsReset();
+				statsCalculate(&stats);
+				redraw = true;
+			}
 		}
+		if (redraw) screenSync();
 		varPUTPNT = varGETPNT;
-	} while (varNEWKEY_row7.esc);
+	} while (key != KEY_ESC);
+
+	if (stats.total) historyAdd('G', historyTurbo(), stats.median, 0);
 
 	restoreScreen();
 	varPUTPNT = varGETPNT;
@@ -737,6 +1251,9 @@ int main(char **argv, int argc) __sdcccall(0)
 
 void restoreScreen()
 {
+	// Show the first name & blink tables again
+	screenPagesRestore();
+
 	// Clean & restore original screen parameters & colors
 	__asm
 		ld   ix, #DISSCR